@@ -0,0 +1,521 @@
+#include "../minui.hpp"
+
+#include <chrono>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+using namespace minui;
+
+// Benchmarks of the ui thread hot paths, results are printed as JSON.
+//
+// headless: g++ -O2 -std=c++11 -DMINUI_HEADLESS benchmark/main.cpp -o minui-bench -pthread
+// gtk:      g++ -O2 -std=c++11 benchmark/main.cpp -o minui-bench -pthread -ldl && xvfb-run ./minui-bench
+// direct:   g++ -O2 -std=c++11 -DMINUI_GTK_DIRECT benchmark/main.cpp -o minui-bench -pthread -ldl && xvfb-run ./minui-bench
+
+const uint8_t logoBmpData[] =
+#include "../example/logo.light.bmp.data"
+;
+
+using Clock = std::chrono::steady_clock;
+
+static int64_t elapsedNs(Clock::time_point start)
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+}
+
+struct Result
+{
+	std::string name;
+	int64_t iterations;
+	int64_t totalNs;
+	int64_t p50Ns;
+	int64_t p99Ns;
+	int64_t repaints; // -1 if not counted
+	int64_t allocations; // paint buffer heap allocations (FrameArena::allocations), -1 if not counted
+};
+
+static std::vector<Result> results;
+
+static void report(const std::string& name, int64_t iterations, int64_t totalNs, std::vector<int64_t> samples = {})
+{
+	int64_t p50 = 0;
+	int64_t p99 = 0;
+	if (!samples.empty())
+	{
+		std::sort(samples.begin(), samples.end());
+		p50 = samples[samples.size() / 2];
+		p99 = samples[samples.size() * 99 / 100];
+	}
+	results.push_back(Result{ name, iterations, totalNs, p50, p99, -1, -1 });
+	fprintf(stderr, "%-36s %10.1f ns/op\n", name.c_str(), double(totalNs) / double(iterations));
+}
+
+template <typename F>
+static void measure(const std::string& name, int64_t iterations, const F& fn)
+{
+	auto start = Clock::now();
+	for (int64_t i = 0; i < iterations; ++i)
+		fn(i);
+	report(name, iterations, elapsedNs(start));
+}
+
+// make sure queued ui work is done (and painted on headless)
+static void flush()
+{
+#ifdef MINUI_SOFTWARE
+	Application::iterate();
+#else
+	Application::runOnUI([]() {});
+#endif
+}
+
+#ifdef MINUI_SOFTWARE
+static uint64_t surfaceHash(const Window& window)
+{
+	uint64_t h = 1469598103934665603ull;
+	for (uint32_t px : window.surface().pixels)
+	{
+		h ^= px;
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+#endif
+
+static void benchRunOnUI(int threads, int calls)
+{
+	std::vector<std::vector<int64_t>> samples(threads);
+	std::vector<std::thread> producers;
+	std::atomic<int> running(threads);
+
+	auto start = Clock::now();
+	for (int t = 0; t < threads; ++t)
+	{
+		producers.emplace_back([&, t]()
+		{
+			samples[t].reserve(calls);
+			for (int i = 0; i < calls; ++i)
+			{
+				auto begin = Clock::now();
+				Application::runOnUI([]() {});
+				samples[t].push_back(elapsedNs(begin));
+			}
+
+			if (--running == 0)
+			{
+			#ifdef MINUI_SOFTWARE
+				Application::quit();
+			#endif
+			}
+		});
+	}
+
+#ifdef MINUI_SOFTWARE
+	Application::exec(); // this is the ui thread
+#endif
+	for (auto& producer : producers)
+		producer.join();
+	int64_t total = elapsedNs(start);
+
+	std::vector<int64_t> all;
+	for (auto& s : samples)
+		all.insert(all.end(), s.begin(), s.end());
+
+	// total is wall time for all threads, so ns/op is the inverse of throughput
+	report("run_on_ui/threads:" + std::to_string(threads), int64_t(threads) * calls, total, all);
+}
+
+// probe round trips on one lane while workers flood 1 ms calls into another
+static void benchLanes(Application::Lane probe, Application::Lane flood, const char* name)
+{
+	enum { FloodThreads = 16, Probes = 200 };
+
+	std::atomic<bool> stop(false);
+	std::atomic<int> running(FloodThreads + 1);
+	std::vector<std::thread> threads;
+	for (int t = 0; t < FloodThreads; ++t)
+	{
+		threads.emplace_back([&]()
+		{
+			while (!stop)
+			{
+				Application::runOnUI([]()
+				{
+					auto begin = Clock::now();
+					while (elapsedNs(begin) < 1000000);
+				}, flood);
+			}
+			running--;
+		});
+	}
+
+	std::vector<int64_t> samples;
+	auto start = Clock::now();
+	threads.emplace_back([&]()
+	{
+		for (int i = 0; i < Probes; ++i)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			auto begin = Clock::now();
+			Application::runOnUI([]() {}, probe);
+			samples.push_back(elapsedNs(begin));
+		}
+		stop = true;
+		running--;
+	});
+
+#ifdef MINUI_SOFTWARE
+	while (running > 0)
+		Application::pump(1); // this is the ui thread
+#endif
+	for (auto& thread : threads)
+		thread.join();
+	int64_t total = elapsedNs(start);
+
+	report(std::string("run_on_ui_lanes/") + name, Probes, total, samples);
+	fprintf(stderr, "%-36s %10.1f us p50, %.1f us p99\n", "", results.back().p50Ns / 1000.0, results.back().p99Ns / 1000.0);
+}
+
+static void benchWidgets(Window& window)
+{
+	static Progress progress;
+	progress.setRect(Rect{ 10, 10, 300, 10 });
+	window.addWidget(&progress);
+
+	measure("progress_set_step", 20000, [&](int64_t i)
+	{
+		progress.setStep(float(i % 100) / 100.0f);
+	});
+	flush();
+
+	static Label label;
+	label.setRect(Rect{ 10, 30, 300, 30 });
+	window.addWidget(&label);
+
+	static const char* texts[] = { "Copying files", "Extracting payload", "Writing registry", "Creating shortcuts" };
+	measure("label_set_text/repeated", 20000, [&](int64_t i)
+	{
+		label.setText(texts[i % 4]);
+	});
+	flush();
+
+	char buf[64];
+	measure("label_set_text/unique", 20000, [&](int64_t i)
+	{
+		snprintf(buf, sizeof(buf), "Copying file %d of 20000", int(i));
+		label.setText(buf);
+	});
+	flush();
+
+#ifdef MINUI_SOFTWARE
+	// setText alone has to reach the framebuffer, not only the next full window update
+	label.setText("Copying files");
+	flush();
+	uint64_t before = surfaceHash(window);
+	label.setText("Removing the old files");
+	if (!Application::iterate() || surfaceHash(window) == before)
+	{
+		fprintf(stderr, "label_set_text: framebuffer unchanged after setText\n");
+		exit(1);
+	}
+
+	// shrinking a scrolled list keeps a full page in view
+	ListView list;
+	list.setRect(Rect{ 0, 0, 300, 240 }); // 10 rows
+	list.setCount(1000);
+	list.scrollTo(1000);
+	list.setCount(50);
+	int shrunk = list.scrollRow();
+	list.setCount(5);
+	if (shrunk != 40 || list.scrollRow() != 0)
+	{
+		fprintf(stderr, "list_view_set_count: first row %d and %d after shrinking, expected 40 and 0\n", shrunk, list.scrollRow());
+		exit(1);
+	}
+#endif
+
+	measure("widget_create/label", 200, [&](int64_t i)
+	{
+		Label* w = new Label();
+		w->setRect(Rect{ 0, 0, 10, 10 });
+		w->setText("label");
+		delete w; // gtk handle is kept by the toolkit, only the wrapper goes away
+	});
+
+	measure("widget_create/button", 200, [&](int64_t i)
+	{
+		Button* w = new Button();
+		w->setRect(Rect{ 0, 0, 10, 10 });
+		w->setText("button");
+		delete w;
+	});
+}
+
+static void benchStyles()
+{
+	// names must outlive the registry
+	static char names[256][32];
+	auto& styles = Styles::instance();
+	Style style = Style::defaultStyle();
+
+	// on top of the default styles
+	int count = 0;
+	for (int target : { 4, 8, 16, 64, 256 })
+	{
+		for (; count < target; ++count)
+		{
+			snprintf(names[count], sizeof(names[count]), "bench-style-%d", count);
+			styles.setStyle(names[count], style);
+		}
+
+		const char* last = names[count - 1];
+		measure("styles_get_style/count:" + std::to_string(count), 100000, [&](int64_t)
+		{
+			volatile int radius = styles.getStyle(last).radius;
+			(void)radius;
+		});
+
+#if defined(__linux__) && !defined(MINUI_SOFTWARE)
+		// only gtk regenerates its css here, elsewhere update() is empty
+		measure("styles_update/count:" + std::to_string(count), 200, [&](int64_t)
+		{
+			styles.update();
+		});
+#endif
+	}
+}
+
+static void benchImage(Window& window)
+{
+	static Image images[3];
+	int sizes[3] = { 32, 128, 512 };
+	for (int i = 0; i < 3; ++i)
+	{
+		int size = sizes[i];
+		Image& image = images[i];
+		image.setRect(Rect{ 0, 0, size, size });
+		window.addWidget(&image);
+
+		measure("image_decode_scale/size:" + std::to_string(size), 50, [&](int64_t)
+		{
+			image.setBmpData(logoBmpData, sizeof(logoBmpData));
+			window.update(); // headless decodes while painting
+			flush();
+		});
+		image.setVisible(false);
+	}
+}
+
+#ifdef MINUI_SOFTWARE
+// pointer sweep over a window full of widgets, every move is a hit test
+static void benchHitTest()
+{
+	for (int count : { 16, 64, 256 })
+	{
+		Window window;
+		window.create();
+		window.setSize(640, 640);
+
+		std::vector<std::unique_ptr<Label>> labels;
+		for (int i = 0; i < count; ++i)
+		{
+			labels.emplace_back(new Label());
+			labels.back()->setRect(Rect{ (i % 16) * 40, (i / 16) * 40, 36, 36 });
+			window.addWidget(labels.back().get());
+		}
+
+		measure("hit_test/widgets:" + std::to_string(count), 200000, [&](int64_t i)
+		{
+			window.injectMouseMove(Point{ int(i * 7 % 640), int(i * 13 % 640) });
+			window.flushInput();
+		});
+	}
+}
+
+// full repaints of a page at growing device scale, large ones are rasterized in tiles on the workers
+static void benchPaint()
+{
+	for (int scale : { 1, 2, 3 })
+	{
+		Window window;
+		window.create();
+		window.setSize(800, 600);
+		window.setScale(float(scale));
+		window.show();
+
+		Label title;
+		title.setRect(Rect{ 20, 40, 500, 40 });
+		title.setText("Installing minui benchmark");
+		window.addWidget(&title);
+
+		Image logo;
+		logo.setRect(Rect{ 20, 100, 256, 256 });
+		logo.setBmpData(logoBmpData, sizeof(logoBmpData));
+		window.addWidget(&logo);
+
+		Progress progress;
+		progress.setRect(Rect{ 20, 400, 760, 10 });
+		progress.setStep(0.6f);
+		window.addWidget(&progress);
+
+		Button buttons[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			buttons[i].setRect(Rect{ 300 + i * 120, 540, 110, 40 });
+			buttons[i].setText("Next");
+			window.addWidget(&buttons[i]);
+		}
+
+		// tiles land on any worker, the first frames fill their mask caches
+		for (int i = 0; i < 10; ++i)
+		{
+			window.update();
+			flush();
+		}
+
+		uint64_t allocations = utils::FrameArena::allocations();
+		measure("paint_full/scale:" + std::to_string(scale), 20, [&](int64_t)
+		{
+			window.update();
+			Application::iterate();
+		});
+		results.back().allocations = int64_t(utils::FrameArena::allocations() - allocations);
+		fprintf(stderr, "%-36s %10d paint buffer allocations\n", "", int(results.back().allocations));
+	}
+}
+
+// every button repainted each frame, filled through its cached coverage mask or rasterized again
+static void benchRoundRect()
+{
+	for (bool masked : { true, false })
+	{
+		Painter::setMaskCache(masked);
+
+		Window window;
+		window.create();
+		window.setSize(640, 480);
+		window.setScale(2.0f);
+		window.show();
+
+		Button buttons[32];
+		for (int i = 0; i < 32; ++i)
+		{
+			buttons[i].setRect(Rect{ 10 + (i % 4) * 156, 10 + (i / 4) * 58, 146, 48 });
+			window.addWidget(&buttons[i]);
+		}
+		flush();
+
+		measure(std::string("round_rect_fill/") + (masked ? "masked" : "rasterized"), 50, [&](int64_t)
+		{
+			for (auto& button : buttons)
+				button.update();
+			Application::iterate();
+		});
+	}
+	Painter::setMaskCache(true);
+}
+
+// scripted sweep across a row of buttons, 8 moves per 16 ms frame for 2 s, counts the frames painted
+static void benchPointerSweep(int transition)
+{
+	Window window;
+	window.create();
+	window.setSize(640, 100);
+	window.show();
+
+	Button buttons[8];
+	for (int i = 0; i < 8; ++i)
+	{
+		buttons[i].setRect(Rect{ 10 + i * 78, 40, 70, 30 });
+		buttons[i].setTransition(transition);
+		window.addWidget(&buttons[i]);
+	}
+	flush();
+
+	int frames = 125;
+	int moves = frames * 8;
+	int painted = window.frameCount();
+	uint64_t allocations = utils::FrameArena::allocations();
+	auto start = Clock::now();
+	for (int f = 0; f < frames; ++f)
+	{
+		for (int m = 0; m < 8; ++m)
+			window.injectMouseMove(Point{ (f * 8 + m) * 640 / moves, 55 });
+		Application::advance(16);
+	}
+	report("pointer_sweep/transition:" + std::to_string(transition), moves, elapsedNs(start));
+	results.back().repaints = window.frameCount() - painted;
+	results.back().allocations = int64_t(utils::FrameArena::allocations() - allocations);
+	fprintf(stderr, "%-36s %10d repaints in %d frames, %d paint buffer allocations\n", "", int(results.back().repaints), frames, int(results.back().allocations));
+}
+#endif
+
+static void printJson(FILE* out)
+{
+#if defined(MINUI_GTK_DIRECT)
+	const char* backend = "gtk-direct";
+#elif defined(MINUI_SOFTWARE)
+	const char* backend = "headless";
+#else
+	const char* backend = "gtk";
+#endif
+	fprintf(out, "{\n  \"backend\": \"%s\",\n  \"results\": [\n", backend);
+	for (size_t i = 0; i < results.size(); ++i)
+	{
+		const Result& r = results[i];
+		fprintf(out, "    {\"name\": \"%s\", \"iterations\": %lld, \"ns_per_op\": %.1f, \"ops_per_sec\": %.1f, \"p50_ns\": %lld, \"p99_ns\": %lld",
+			r.name.c_str(), (long long)r.iterations, double(r.totalNs) / double(r.iterations),
+			double(r.iterations) * 1e9 / double(r.totalNs), (long long)r.p50Ns, (long long)r.p99Ns);
+		if (r.repaints >= 0)
+			fprintf(out, ", \"repaints\": %lld", (long long)r.repaints);
+		if (r.allocations >= 0)
+			fprintf(out, ", \"paint_allocations\": %lld", (long long)r.allocations);
+		fprintf(out, "}%s\n", i + 1 < results.size() ? "," : "");
+	}
+	fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv)
+{
+	if (!Application::initialize("com.github.minui.benchmark"))
+	{
+		fprintf(stderr, "initialize application failed!\n");
+		return 1;
+	}
+
+	Window window;
+	window.create();
+	window.setSize(640, 640);
+	window.setTitle("minui benchmark");
+	window.show();
+	flush();
+
+	int producers = int(std::thread::hardware_concurrency());
+	if (producers < 4)
+		producers = 4;
+	for (int threads = 1; threads <= producers; threads *= 2)
+		benchRunOnUI(threads, 20000 / threads);
+	benchLanes(Application::Normal, Application::Normal, "probe:normal/flood:normal");
+	benchLanes(Application::High, Application::Normal, "probe:high/flood:normal");
+	benchLanes(Application::Normal, Application::Bulk, "probe:normal/flood:bulk");
+
+	benchWidgets(window);
+	benchStyles();
+	benchImage(window);
+#ifdef MINUI_SOFTWARE
+	benchHitTest();
+	benchPaint();
+	benchRoundRect();
+	benchPointerSweep(0);
+	benchPointerSweep(Button::TransitionTime);
+#endif
+
+	FILE* out = argc > 1 ? fopen(argv[1], "w") : stdout;
+	if (!out)
+		return 1;
+	printJson(out);
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
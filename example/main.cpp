@@ -92,6 +92,7 @@ int main()
 	button4.setOnClick([&]()
 		{
 			autoDark = true;
+			setDarkStyles(Application::isDarkMode());
 		}
 	);
 	window.addWidget(&button4);
@@ -104,13 +105,17 @@ int main()
 	progress.setRect(Rect{ button5.rect().x + button5.rect().width + 10, button5.rect().y + 15, 400, 10 });
 	window.addWidget(&progress);
 
-	int step = 0;
+	// pulse on its own until the timer has real progress, 2 s in
+	progress.setIndeterminate(true);
+	int step = -40;
 	window.addTimer(500, [&]()
 		{
 			step += 10;
+			if (step < 0)
+				return false;
 			if (step > 100)
 				step = 0;
-			progress.setStep(float(step) / 100.0);
+			progress.setStep(float(step) / 100.0, step ? 300 : 0); // slide forward, restart at once
 			return false;
 		}
 	);
@@ -140,56 +145,65 @@ int main()
 	logo3.setRect(Rect{ logo2.rect().x + logo2.rect().width + 10, logo2.rect().y, 128, 128 });
 	window.addWidget(&logo3);
 
-	setDarkStyles = [&](bool darkMode)
+	// theme bundles on top of the built-in constexpr tables, prepared once,
+	// switching only swaps the active one
+	Theme lightTheme("light", DefaultStyles<>::light, DefaultStyles<>::lightCss);
+	Theme darkTheme("dark", DefaultStyles<>::dark, DefaultStyles<>::darkCss);
+	auto prepareTheme = [&](Theme& theme, bool darkMode)
 		{
-			Application::setStyles(darkMode);
-
-			auto& styles = Styles::instance();
-			auto style = styles.getStyle("label");
+			auto style = *theme.findStyle("label");
 
 			auto titleStyle = style;
 			titleStyle.fontSize = 32;
-			styles.setStyle(TitleLabel, titleStyle);
+			theme.setStyle(TitleLabel, titleStyle);
 
 			auto colorLabel = style;
 			colorLabel.color = Color{ 0, 180, 0 };
-			styles.setStyle(ColorLabel, colorLabel);
+			theme.setStyle(ColorLabel, colorLabel);
 
 			auto colorButton = style;
 			colorButton.backgroundColor = Color{ 53, 132, 220 };
-			styles.setStyle(ColorButton, colorButton);
+			theme.setStyle(ColorButton, colorButton);
 
-			colorButton.backgroundColor = Color{ 73, 140, 230 };
-			styles.setStyle(ColorButtonHover, colorButton);
+			// states only store the background, the rest follows ColorButton
+			Style state = {};
+			state.backgroundColor = Color{ 73, 140, 230 };
+			theme.setStyle(ColorButtonHover, ColorButton, state, Style::BackgroundColorField);
 
-			colorButton.backgroundColor = Color{ 42, 106, 183 };
-			styles.setStyle(ColorButtonPress, colorButton);
+			state.backgroundColor = Color{ 42, 106, 183 };
+			theme.setStyle(ColorButtonPress, ColorButton, state, Style::BackgroundColorField);
 
-			dark = darkMode;
-			button3.setText(dark ? "Light" : "Dark");
+			if (darkMode)
+				theme.setImage("logo", logoDarkBmpData, sizeof(logoDarkBmpData));
+			else
+				theme.setImage("logo", logoLightBmpData, sizeof(logoLightBmpData));
 
-			auto logoData = darkMode ? logoDarkBmpData : logoLightBmpData;
-			auto logDataLen = darkMode ? sizeof(logoDarkBmpData) : sizeof(logoLightBmpData);
-			logo1.setBmpData(logoData, logDataLen);
-			logo2.setBmpData(logoData, logDataLen);
-			logo3.setBmpData(logoData, logDataLen);
+			theme.prepare();
+		};
+	prepareTheme(lightTheme, false);
+	prepareTheme(darkTheme, true);
+
+	logo1.setThemeImage("logo");
+	logo2.setThemeImage("logo");
+	logo3.setThemeImage("logo");
 
-			styles.update();
+	setDarkStyles = [&](bool darkMode)
+		{
+			Styles::instance().setTheme(darkMode ? &darkTheme : &lightTheme);
+
+			dark = darkMode;
+			button3.setText(dark ? "Light" : "Dark");
 		};
 
 	setDarkStyles(dark);
 
 	// auto set dark
-	window.addTimer(1000, [&]()
+	Application::setOnThemeChanged([&](bool darkMode)
 		{
 			if (autoDark)
-			{
-				bool darkMode = Application::isDarkMode(); // timed check dark mode
 				setDarkStyles(darkMode);
-			}
-			return false;
 		}
-	); 
+	);
 
 	window.show();
 	Application::exec();
@@ -200,4 +214,4 @@ int main()
 int CALLBACK WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int CmdShow) {
 	return main();
 }
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
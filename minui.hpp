@@ -6,10 +6,4669 @@
 #include <windows.h>
 #include <windowsx.h>
 #include <dwmapi.h>
+#endif
+
+#ifdef __linux__
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
+
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <new>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+// MINUI_HEADLESS and MINUI_GTK_DIRECT share the software renderer
+#if defined(MINUI_HEADLESS) || (defined(__linux__) && defined(MINUI_GTK_DIRECT))
+#define MINUI_SOFTWARE
+#endif
+
+namespace minui
+{
+	// Scoped timeline events in per-thread lock-free rings, written as Chrome trace-event JSON
+	// (chrome://tracing, ui.perfetto.dev). Event names must be string literals.
+	class Trace
+	{
+	public:
+		enum { Capacity = 16384 }; // events kept per thread
+
+		class Scope
+		{
+		public:
+			explicit Scope(const char* name)
+				: name_(name)
+				, begin_(enabled() ? now() : 0)
+			{
+
+			}
+
+			~Scope()
+			{
+				if (begin_)
+					emit(name_, begin_, now() - begin_);
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			const char* name_;
+			int64_t begin_;
+		};
+
+		static bool enabled()
+		{
+			return instance().enabled_.load(std::memory_order_relaxed);
+		}
+
+		static void setEnabled(bool v)
+		{
+			instance().enabled_.store(v, std::memory_order_relaxed);
+		}
+
+		static int64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		// cheap when tracing is off, the name is kept until the thread emits its first event
+		static void setThreadName(const char* name)
+		{
+			threadName() = name;
+			if (local())
+				local()->name_.store(name, std::memory_order_release);
+		}
+
+		// owner thread only writes its own ring, no locks
+		static void emit(const char* name, int64_t begin, int64_t duration)
+		{
+			Buffer* buf = buffer();
+			uint32_t index = buf->head_.load(std::memory_order_relaxed);
+			Event& e = buf->events_[index % Capacity];
+			e.seq_.store(0, std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_release);
+			e.name_ = name;
+			e.begin_ = begin;
+			e.duration_ = duration;
+			e.seq_.store(index + 1, std::memory_order_release);
+			buf->head_.store(index + 1, std::memory_order_release);
+		}
+
+		static bool write(FILE* out)
+		{
+			fprintf(out, "{\"traceEvents\":[\n");
+			bool first = true;
+			for (Buffer* buf = instance().buffers_.load(std::memory_order_acquire); buf; buf = buf->next_)
+			{
+				const char* threadName = buf->name_.load(std::memory_order_acquire);
+				if (threadName)
+				{
+					fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", buf->tid_, threadName);
+					first = false;
+				}
+
+				uint32_t head = buf->head_.load(std::memory_order_acquire);
+				uint32_t begin = head > Capacity ? head - Capacity : 0;
+				for (uint32_t i = begin; i < head; ++i)
+				{
+					const Event& e = buf->events_[i % Capacity];
+					if (e.seq_.load(std::memory_order_acquire) != i + 1)
+						continue;
+
+					const char* name = e.name_;
+					int64_t ts = e.begin_;
+					int64_t dur = e.duration_;
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (e.seq_.load(std::memory_order_relaxed) != i + 1)
+						continue; // overwritten while reading
+
+					fprintf(out, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", first ? "" : ",\n", name, buf->tid_, double(ts) / 1000.0, double(dur) / 1000.0);
+					first = false;
+				}
+			}
+			fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+			return !ferror(out);
+		}
+
+		static bool save(const char* path)
+		{
+			FILE* out = fopen(path, "w");
+			if (!out)
+				return false;
+			bool ok = write(out);
+			return fclose(out) == 0 && ok;
+		}
+
+	private:
+		struct Event
+		{
+			std::atomic<uint32_t> seq_{ 0 }; // index + 1 once complete
+			const char* name_ = nullptr;
+			int64_t begin_ = 0;
+			int64_t duration_ = 0;
+		};
+
+		// never freed, rings of exited threads stay readable
+		struct Buffer
+		{
+			std::atomic<uint32_t> head_{ 0 };
+			std::atomic<const char*> name_{ nullptr };
+			uint32_t tid_ = 0;
+			Buffer* next_ = nullptr;
+			Event events_[Capacity];
+		};
+
+		static Trace& instance()
+		{
+			static Trace trace;
+			return trace;
+		}
+
+		static Buffer*& local()
+		{
+			static thread_local Buffer* buf = nullptr;
+			return buf;
+		}
+
+		static const char*& threadName()
+		{
+			static thread_local const char* name = nullptr;
+			return name;
+		}
+
+		static Buffer* buffer()
+		{
+			Buffer*& buf = local();
+			if (!buf)
+			{
+				Trace& trace = instance();
+				buf = new Buffer();
+				buf->name_.store(threadName(), std::memory_order_relaxed);
+				buf->tid_ = trace.nextTid_.fetch_add(1) + 1;
+				buf->next_ = trace.buffers_.load(std::memory_order_relaxed);
+				while (!trace.buffers_.compare_exchange_weak(buf->next_, buf, std::memory_order_release, std::memory_order_relaxed));
+			}
+			return buf;
+		}
+
+		Trace() = default;
+
+		std::atomic<bool> enabled_{ false };
+		std::atomic<Buffer*> buffers_{ nullptr };
+		std::atomic<uint32_t> nextTid_{ 0 };
+	};
+
+	namespace utils
+	{
+		inline size_t hash(const char* str, size_t len)
+		{
+			size_t h = 14695981039346656037ull; // FNV-1a
+			for (size_t i = 0; i < len; ++i)
+				h = (h ^ uint8_t(str[i])) * 1099511628211ull;
+			return h;
+		}
+
+		// Immutable, reference counted text, interned so equal texts share one entry.
+		// The entry holds the characters inline (one allocation per distinct text, none per copy),
+		// and on Windows the UTF-16 form is converted once and cached next to the UTF-8.
+		class String
+		{
+		public:
+			String()
+				: entry_(nullptr)
+			{
+
+			}
+
+			String(const char* text)
+				: entry_(text ? intern(text, strlen(text)) : nullptr)
+			{
+
+			}
+
+			String(const char* text, size_t len)
+				: entry_(intern(text, len))
+			{
+
+			}
+
+			String(const String& other)
+				: entry_(other.entry_)
+			{
+				if (entry_)
+					entry_->refs.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			String& operator=(const String& other)
+			{
+				if (other.entry_)
+					other.entry_->refs.fetch_add(1, std::memory_order_relaxed);
+				release(entry_);
+				entry_ = other.entry_;
+				return *this;
+			}
+
+			~String()
+			{
+				release(entry_);
+			}
+
+			// nullptr when not set
+			const char* c_str() const
+			{
+				return entry_ ? entry_->utf8 : nullptr;
+			}
+
+			size_t length() const
+			{
+				return entry_ ? entry_->length : 0;
+			}
+
+			bool empty() const
+			{
+				return length() == 0;
+			}
+
+			bool operator==(const String& other) const
+			{
+				return entry_ == other.entry_; // interned
+			}
+
+			bool operator!=(const String& other) const
+			{
+				return entry_ != other.entry_;
+			}
+
+		#ifdef WIN32
+			const wchar_t* wstr() const
+			{
+				return entry_ ? entry_->utf16 : L"";
+			}
+
+			size_t wlength() const
+			{
+				return entry_ ? entry_->wlength : 0;
+			}
+		#endif
+
+		private:
+			struct Entry
+			{
+				std::atomic<int> refs;
+				Entry* next;
+				size_t hash;
+				size_t length;
+				char* utf8;
+			#ifdef WIN32
+				wchar_t* utf16;
+				size_t wlength;
+			#endif
+			};
+
+			struct Table
+			{
+				std::mutex mtx;
+				Entry** buckets = nullptr;
+				size_t bucketCount = 0;
+				size_t count = 0;
+			};
+
+			static Table& table()
+			{
+				static Table tab;
+				return tab;
+			}
+
+			static Entry* intern(const char* text, size_t len)
+			{
+				size_t h = hash(text, len);
+				Table& tab = table();
+				std::lock_guard<std::mutex> lock(tab.mtx);
+
+				if (tab.bucketCount)
+				{
+					for (Entry* e = tab.buckets[h % tab.bucketCount]; e; e = e->next)
+					{
+						if (e->hash == h && e->length == len && memcmp(e->utf8, text, len) == 0)
+						{
+							e->refs.fetch_add(1, std::memory_order_relaxed);
+							return e;
+						}
+					}
+				}
+
+				if (tab.count >= tab.bucketCount)
+					rehash(tab, tab.bucketCount ? tab.bucketCount * 2 : 64);
+
+				Entry* e = create(text, len, h);
+				Entry*& head = tab.buckets[h % tab.bucketCount];
+				e->next = head;
+				head = e;
+				tab.count++;
+				return e;
+			}
+
+			static void release(Entry* entry)
+			{
+				if (!entry)
+					return;
+
+				size_t h = entry->hash;
+				if (entry->refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+					return;
+
+				// the entry may be revived or freed by another thread meanwhile, only touch it while still linked
+				Table& tab = table();
+				std::lock_guard<std::mutex> lock(tab.mtx);
+				for (Entry** link = &tab.buckets[h % tab.bucketCount]; *link; link = &(*link)->next)
+				{
+					if (*link == entry)
+					{
+						if (entry->refs.load(std::memory_order_acquire) == 0)
+						{
+							*link = entry->next;
+							tab.count--;
+							entry->~Entry();
+							free(entry);
+						}
+						return;
+					}
+				}
+			}
+
+			static void rehash(Table& tab, size_t count)
+			{
+				auto buckets = (Entry**)calloc(count, sizeof(Entry*));
+				for (size_t i = 0; i < tab.bucketCount; ++i)
+				{
+					Entry* e = tab.buckets[i];
+					while (e)
+					{
+						Entry* next = e->next;
+						e->next = buckets[e->hash % count];
+						buckets[e->hash % count] = e;
+						e = next;
+					}
+				}
+				free(tab.buckets);
+				tab.buckets = buckets;
+				tab.bucketCount = count;
+			}
+
+			static Entry* create(const char* text, size_t len, size_t h)
+			{
+				size_t size = sizeof(Entry) + len + 1;
+			#ifdef WIN32
+				int wlen = len ? MultiByteToWideChar(CP_UTF8, 0, text, int(len), NULL, 0) : 0;
+				size_t offset = (size + alignof(wchar_t) - 1) & ~(alignof(wchar_t) - 1);
+				size = offset + (wlen + 1) * sizeof(wchar_t);
+			#endif
+
+				auto e = new (malloc(size)) Entry;
+				e->refs.store(1, std::memory_order_relaxed);
+				e->next = nullptr;
+				e->hash = h;
+				e->length = len;
+				e->utf8 = (char*)(e + 1);
+				memcpy(e->utf8, text, len);
+				e->utf8[len] = 0;
+			#ifdef WIN32
+				e->utf16 = (wchar_t*)((char*)e + offset);
+				if (wlen)
+					MultiByteToWideChar(CP_UTF8, 0, text, int(len), e->utf16, wlen);
+				e->utf16[wlen] = 0;
+				e->wlength = wlen;
+			#endif
+				return e;
+			}
+
+		private:
+			Entry* entry_;
+		};
+
+		// Growable style registry behind Theme, looked up by hashed name. An entry keeps only the
+		// fields it overrides and inherits the rest from its parent. Changing an entry re-resolves
+		// that entry and its dependants, so lookups are plain reads of the resolved styles.
+		template <typename S>
+		class StyleTable
+		{
+		public:
+			StyleTable() = default;
+			StyleTable(const StyleTable&) = delete;
+			StyleTable& operator=(const StyleTable&) = delete;
+
+			int count() const
+			{
+				return int(entries_.size());
+			}
+
+			// -1 if missing
+			int find(const char* name) const
+			{
+				return find(name, hash(name, strlen(name)));
+			}
+
+			// resolved, stays valid while the table lives
+			const S& style(int index) const
+			{
+				return resolved_[index];
+			}
+
+			// parent is an index or -1 for the default style, returns -1 if parent would be a dependant
+			int set(const char* name, int parent, const S& style, int fields)
+			{
+				size_t h = hash(name, strlen(name));
+				int index = find(name, h);
+				if (index == -1)
+				{
+					index = int(entries_.size());
+					entries_.push_back(Entry{ name, h, -1, 0, -1, -1, {}, {}, 0, 0, -1 });
+					resolved_.emplace_back();
+					insert(index);
+				}
+				else
+				{
+					for (int p = parent; p != -1; p = entries_[p].parent_)
+					{
+						if (p == index)
+							return -1;
+					}
+					unlink(index);
+				}
+
+				Entry& e = entries_[index];
+				e.parent_ = parent;
+				e.fields_ = fields;
+				e.color_ = style.color;
+				e.backgroundColor_ = style.backgroundColor;
+				e.radius_ = style.radius;
+				e.fontSize_ = style.fontSize;
+				if (fields & S::FontFamilyField)
+				{
+					if (e.fontFamily_ == -1)
+					{
+						e.fontFamily_ = int(families_.size());
+						families_.emplace_back();
+					}
+					memcpy(families_[e.fontFamily_].names, style.fontFamily, sizeof(style.fontFamily));
+				}
+
+				if (parent != -1)
+				{
+					e.nextSibling_ = entries_[parent].firstChild_;
+					entries_[parent].firstChild_ = index;
+				}
+
+				resolve(index);
+				return index;
+			}
+
+		private:
+			struct Entry
+			{
+				const char* name_;
+				size_t hash_;
+				int parent_;
+				int fields_;
+				int firstChild_;
+				int nextSibling_;
+				decltype(S::color) color_;
+				decltype(S::backgroundColor) backgroundColor_;
+				int radius_;
+				int fontSize_;
+				int fontFamily_; // index into families_, -1 when inherited
+			};
+
+			struct FontFamily
+			{
+				const char* names[S::FontFamilyCount];
+			};
+
+			int find(const char* name, size_t h) const
+			{
+				if (slots_.empty())
+					return -1;
+
+				size_t mask = slots_.size() - 1;
+				for (size_t i = h & mask; slots_[i] != -1; i = (i + 1) & mask)
+				{
+					const Entry& e = entries_[slots_[i]];
+					if (e.hash_ == h && strcmp(e.name_, name) == 0)
+						return slots_[i];
+				}
+				return -1;
+			}
+
+			// open addressing, kept at most half full
+			void insert(int index)
+			{
+				if (entries_.size() * 2 > slots_.size())
+				{
+					slots_.assign(slots_.empty() ? 16 : slots_.size() * 2, -1);
+					for (int i = 0; i < int(entries_.size()); ++i)
+						place(i);
+				}
+				else
+				{
+					place(index);
+				}
+			}
+
+			void place(int index)
+			{
+				size_t mask = slots_.size() - 1;
+				size_t i = entries_[index].hash_ & mask;
+				while (slots_[i] != -1)
+					i = (i + 1) & mask;
+				slots_[i] = index;
+			}
+
+			void unlink(int index)
+			{
+				int parent = entries_[index].parent_;
+				if (parent == -1)
+					return;
+
+				for (int* link = &entries_[parent].firstChild_; *link != -1; link = &entries_[*link].nextSibling_)
+				{
+					if (*link == index)
+					{
+						*link = entries_[index].nextSibling_;
+						break;
+					}
+				}
+				entries_[index].nextSibling_ = -1;
+			}
+
+			void resolve(int index)
+			{
+				const Entry& e = entries_[index];
+				S& style = resolved_[index];
+				style = e.parent_ != -1 ? resolved_[e.parent_] : S::defaultStyle();
+				style.name = e.name_;
+				if (e.fields_ & S::ColorField)
+					style.color = e.color_;
+				if (e.fields_ & S::BackgroundColorField)
+					style.backgroundColor = e.backgroundColor_;
+				if (e.fields_ & S::RadiusField)
+					style.radius = e.radius_;
+				if (e.fields_ & S::FontSizeField)
+					style.fontSize = e.fontSize_;
+				if (e.fields_ & S::FontFamilyField)
+					memcpy(style.fontFamily, families_[e.fontFamily_].names, sizeof(style.fontFamily));
+
+				for (int child = e.firstChild_; child != -1; child = entries_[child].nextSibling_)
+					resolve(child);
+			}
+
+			std::vector<Entry> entries_;
+			std::deque<S> resolved_; // stable references
+			std::vector<FontFamily> families_;
+			std::vector<int> slots_;
+		};
+
+		// Styles and themed images of a named theme, the part of Theme shared by the backends.
+		// S is the backend's Style; the read-only table answers what the overrides do not.
+		template <typename S>
+		class ThemeBase
+		{
+		public:
+			enum { ImageCount = 8 };
+
+			struct ImageData
+			{
+				const char* name;
+				const void* data;
+				int size;
+			};
+
+			explicit ThemeBase(const char* name, const S* table = nullptr, int tableCount = 0)
+				: name_(name)
+				, table_(table)
+				, tableCount_(tableCount)
+			{
+			}
+
+			// compile-time lookup in a constexpr table, -1 if missing
+			template <size_t N>
+			static constexpr int indexOf(const S (&table)[N], const char* name, size_t i = 0)
+			{
+				return i == N ? -1 : equals(table[i].name, name) ? int(i) : indexOf(table, name, i + 1);
+			}
+
+			const char* name() const
+			{
+				return name_;
+			}
+
+			bool setStyle(const char* name, const S& style)
+			{
+				return styles_.set(name, -1, style, S::AllFields) != -1;
+			}
+
+			// derive from parent and store only the given Style::Field bits, the rest follow the parent
+			bool setStyle(const char* name, const char* parent, const S& style, int fields)
+			{
+				int index = styles_.find(parent);
+				if (index == -1)
+				{
+					// a table style is copied in once so its dependants can be tracked
+					const S* base = findTable(parent);
+					if (!base)
+						return false;
+					index = styles_.set(parent, -1, *base, S::AllFields);
+				}
+				return styles_.set(name, index, style, fields) != -1;
+			}
+
+			const S* findStyle(const char* name) const
+			{
+				int index = styles_.find(name);
+				if (index != -1)
+					return &styles_.style(index);
+				return findTable(name);
+			}
+
+			// bmp data, must outlive the theme. False when all ImageCount slots are taken.
+			bool setImage(const char* name, const void* data, int size)
+			{
+				for (int i = 0; i < imageIndex_; ++i)
+				{
+					if (strcmp(images_[i].name, name) == 0)
+					{
+						images_[i] = ImageData{ name, data, size };
+						return true;
+					}
+				}
+
+				if (imageIndex_ == ImageCount)
+					return false;
+				images_[imageIndex_++] = ImageData{ name, data, size };
+				return true;
+			}
+
+			const ImageData* findImage(const char* name) const
+			{
+				for (int i = 0; i < imageIndex_; ++i)
+				{
+					if (strcmp(images_[i].name, name) == 0)
+						return &images_[i];
+				}
+				return nullptr;
+			}
+
+		protected:
+			static constexpr bool equals(const char* a, const char* b)
+			{
+				return *a == *b && (*a == 0 || equals(a + 1, b + 1));
+			}
+
+			const S* findTable(const char* name) const
+			{
+				for (int i = 0; i < tableCount_; ++i)
+				{
+					if (strcmp(table_[i].name, name) == 0)
+						return &table_[i];
+				}
+				return nullptr;
+			}
+
+			const char* name_;
+			StyleTable<S> styles_;
+			ImageData images_[ImageCount] = { 0 };
+			int imageIndex_ = 0;
+			const S* table_;
+			int tableCount_;
+		};
+
+		// The active theme and the style accessors of Styles, shared by the backends.
+		template <typename T, typename S> // T=Theme, S=Style
+		class StylesBase
+		{
+		public:
+			// writes into the active theme
+			bool setStyle(const char* name, const S& style)
+			{
+				return theme().setStyle(name, style);
+			}
+
+			bool setStyle(const char* name, const char* parent, const S& style, int fields)
+			{
+				return theme().setStyle(name, parent, style, fields);
+			}
+
+			const S& getStyle(const char* name) const
+			{
+				const S* style = theme().findStyle(name);
+				if (style)
+					return *style;
+
+				return S::defaultStyle();
+			}
+
+			T& theme() const
+			{
+				return *theme_.load(std::memory_order_acquire);
+			}
+
+		protected:
+			StylesBase() = default;
+
+			std::atomic<T*> theme_{ &T::builtin(false) };
+		};
+
+		// Uniform grid over boxes in device pixels for point queries, rebuilt as a whole when the
+		// layout changes. Each cell lists the boxes touching it in z-order, so a query only tests those.
+		class HitGrid
+		{
+		public:
+			enum { CellSize = 64 }; // device px
+
+			// drop all boxes, the grid covers width x height
+			void reset(int width, int height)
+			{
+				width_ = width > 0 ? width : 0;
+				height_ = height > 0 ? height : 0;
+				boxes_.clear();
+			}
+
+			// next index in z-order, empty boxes never hit but keep their index
+			void add(int x, int y, int width, int height)
+			{
+				boxes_.push_back(Box{ x, y, width, height });
+			}
+
+			void build()
+			{
+				cols_ = (width_ + CellSize - 1) / CellSize;
+				rows_ = (height_ + CellSize - 1) / CellSize;
+				offsets_.assign(size_t(cols_) * rows_ + 1, 0);
+
+				// count, prefix sum, then fill, items stay in z-order within a cell
+				for (int pass = 0; pass < 2; ++pass)
+				{
+					if (pass == 1)
+					{
+						for (size_t i = 1; i < offsets_.size(); ++i)
+							offsets_[i] += offsets_[i - 1];
+						items_.resize(offsets_.back());
+						fill_.assign(offsets_.begin(), offsets_.end() - 1);
+					}
+
+					for (int i = 0; i < int(boxes_.size()); ++i)
+					{
+						const Box& b = boxes_[i];
+						if (b.width <= 0 || b.height <= 0)
+							continue;
+
+						int c0 = clamp(b.x / CellSize, cols_), c1 = clamp((b.x + b.width) / CellSize, cols_);
+						int r0 = clamp(b.y / CellSize, rows_), r1 = clamp((b.y + b.height - 1) / CellSize, rows_);
+						if (b.x >= width_ || b.y >= height_ || b.x + b.width < 0 || b.y + b.height <= 0)
+							continue;
+
+						for (int r = r0; r <= r1; ++r)
+						{
+							for (int c = c0; c <= c1; ++c)
+							{
+								size_t cell = size_t(r) * cols_ + c;
+								if (pass == 0)
+									offsets_[cell + 1]++;
+								else
+									items_[fill_[cell]++] = i;
+							}
+						}
+					}
+				}
+			}
+
+			// topmost box containing the point, -1 if none
+			int find(int x, int y) const
+			{
+				if (x < 0 || y < 0 || x >= width_ || y >= height_)
+					return -1;
+
+				size_t cell = size_t(y / CellSize) * cols_ + x / CellSize;
+				for (int i = offsets_[cell + 1] - 1; i >= offsets_[cell]; --i)
+				{
+					const Box& b = boxes_[items_[i]];
+					// same edges as Rect::contains
+					if (b.x <= x && x <= b.x + b.width && b.y <= y && y < b.y + b.height)
+						return items_[i];
+				}
+				return -1;
+			}
+
+		private:
+			struct Box
+			{
+				int x;
+				int y;
+				int width;
+				int height;
+			};
+
+			static int clamp(int v, int count)
+			{
+				return v < 0 ? 0 : (v >= count ? count - 1 : v);
+			}
+
+			int width_ = 0;
+			int height_ = 0;
+			int cols_ = 0;
+			int rows_ = 0;
+			std::vector<Box> boxes_;
+			std::vector<int> offsets_; // cells + 1, start of each cell in items_
+			std::vector<int> items_;
+			std::vector<int> fill_;
+		};
+
+		// Bump allocator for painting temporaries that live at most one frame. reset() keeps the
+		// blocks, so once a frame has been painted the same frame allocates nothing from the heap.
+		class FrameArena
+		{
+		public:
+			enum { BlockSize = 16 * 1024, Align = 16 };
+
+			struct Mark
+			{
+				size_t block;
+				size_t used;
+			};
+
+			FrameArena() = default;
+			FrameArena(const FrameArena&) = delete;
+			FrameArena& operator=(const FrameArena&) = delete;
+
+			~FrameArena()
+			{
+				for (auto& block : blocks_)
+					free(block.data);
+			}
+
+			void* allocate(size_t size)
+			{
+				size = (size + Align - 1) & ~size_t(Align - 1);
+				for (; block_ < blocks_.size(); ++block_, used_ = 0)
+				{
+					Block& block = blocks_[block_];
+					if (used_ + size <= block.size)
+					{
+						void* p = block.data + used_;
+						used_ += size;
+						return p;
+					}
+				}
+
+				// malloc is aligned for any fundamental type, bigger requests get a block of their own
+				size_t blockSize = size > size_t(BlockSize) ? size : size_t(BlockSize);
+				blocks_.push_back(Block{ static_cast<char*>(malloc(blockSize)), blockSize });
+				countAllocation();
+				used_ = size;
+				return blocks_.back().data;
+			}
+
+			// uninitialized, T must be trivial
+			template <typename T>
+			T* allocate(size_t count)
+			{
+				return static_cast<T*>(allocate(sizeof(T) * count));
+			}
+
+			// a followed by b, nul terminated
+			const char* concat(const char* a, const char* b)
+			{
+				size_t la = strlen(a), lb = strlen(b);
+				char* str = allocate<char>(la + lb + 1);
+				memcpy(str, a, la);
+				memcpy(str + la, b, lb + 1);
+				return str;
+			}
+
+			// everything allocated after mark() is released by rewind()
+			Mark mark() const
+			{
+				return Mark{ block_, used_ };
+			}
+
+			void rewind(const Mark& mark)
+			{
+				block_ = mark.block;
+				used_ = mark.used;
+			}
+
+			void reset()
+			{
+				block_ = 0;
+				used_ = 0;
+			}
+
+			// heap allocations of the paint buffers: arenas, scratch pools, mask caches and display lists.
+			// Tile dispatch through the task pool and the runOnUI lane drain allocate too and are not counted.
+			static uint64_t allocations()
+			{
+				return counter().load(std::memory_order_relaxed);
+			}
+
+			static void countAllocation()
+			{
+				counter().fetch_add(1, std::memory_order_relaxed);
+			}
+
+			// a vector kept across frames reallocates only when n more elements do not fit
+			template <typename V>
+			static void countGrowth(const V& v, size_t n)
+			{
+				if (v.size() + n > v.capacity())
+					countAllocation();
+			}
+
+		private:
+			struct Block
+			{
+				char* data;
+				size_t size;
+			};
+
+			static std::atomic<uint64_t>& counter()
+			{
+				static std::atomic<uint64_t> count{ 0 };
+				return count;
+			}
+
+			std::vector<Block> blocks_;
+			size_t block_ = 0;
+			size_t used_ = 0;
+		};
+
+		// Work-stealing pool for background work, continuations are queued and run in one batch on the ui thread.
+		class TaskPool
+		{
+		public:
+			using TaskFunc = std::function<void()>;
+			using WakeFunc = void(*)(); // schedule drainUI() on the ui thread
+
+			class Task
+			{
+			public:
+				// fn runs on the ui thread once the task finished
+				Task& thenOnUI(const TaskFunc& fn)
+				{
+					std::unique_lock<std::mutex> lock(state_->mtx_);
+					if (!state_->done_)
+					{
+						state_->then_ = fn;
+						return *this;
+					}
+					lock.unlock();
+					state_->pool_->postUI(fn);
+					return *this;
+				}
+
+				bool done() const
+				{
+					std::lock_guard<std::mutex> lock(state_->mtx_);
+					return state_->done_;
+				}
+
+			private:
+				friend class TaskPool;
+
+				struct State
+				{
+					std::mutex mtx_;
+					bool done_ = false;
+					TaskFunc then_;
+					TaskPool* pool_ = nullptr;
+				};
+
+				Task(const std::shared_ptr<State>& state)
+					: state_(state)
+				{
+
+				}
+
+				std::shared_ptr<State> state_;
+			};
+
+			explicit TaskPool(WakeFunc wake)
+				: wake_(wake)
+			{
+
+			}
+
+			~TaskPool()
+			{
+				{
+					std::lock_guard<std::mutex> lock(sleepMtx_);
+					stop_ = true;
+				}
+				sleepCond_.notify_all();
+				for (auto& worker : workers_)
+					worker->thread_.join();
+			}
+
+			TaskPool(const TaskPool&) = delete;
+			TaskPool& operator=(const TaskPool&) = delete;
+
+			Task submit(const TaskFunc& fn)
+			{
+				auto state = std::make_shared<Task::State>();
+				state->pool_ = this;
+				post([=]()
+				{
+					fn();
+
+					TaskFunc then;
+					{
+						std::lock_guard<std::mutex> lock(state->mtx_);
+						state->done_ = true;
+						then.swap(state->then_);
+					}
+					if (then)
+						postUI(then);
+				});
+				return Task(state);
+			}
+
+			// fn(i) for every i in [0, count) spread over the workers, the calling thread takes
+			// indices too and returns once all of them finished
+			void parallelFor(int count, const std::function<void(int)>& fn)
+			{
+				struct Batch
+				{
+					std::function<void(int)> fn_;
+					int count_;
+					std::atomic<int> next_{ 0 };
+					std::atomic<int> done_{ 0 };
+					std::mutex mtx_;
+					std::condition_variable cond_;
+				};
+
+				auto batch = std::make_shared<Batch>();
+				batch->fn_ = fn;
+				batch->count_ = count;
+				auto work = [batch]()
+				{
+					int i;
+					while ((i = batch->next_.fetch_add(1)) < batch->count_)
+					{
+						batch->fn_(i);
+						if (batch->done_.fetch_add(1) + 1 == batch->count_)
+						{
+							std::lock_guard<std::mutex> lock(batch->mtx_);
+							batch->cond_.notify_all();
+						}
+					}
+				};
+
+				std::call_once(started_, [this]() { start(); });
+				int helpers = count - 1 < int(workers_.size()) ? count - 1 : int(workers_.size());
+				for (int i = 0; i < helpers; ++i)
+					post(work);
+
+				work();
+				std::unique_lock<std::mutex> lock(batch->mtx_);
+				batch->cond_.wait(lock, [&]() { return batch->done_.load() == batch->count_; });
+			}
+
+			void post(TaskFunc fn)
+			{
+				std::call_once(started_, [this]() { start(); });
+
+				// tasks posted from a worker stay local, others are spread round-robin
+				int index = current() == this ? workerIndex() : int(next_++ % workers_.size());
+				Worker& worker = *workers_[index];
+				{
+					std::lock_guard<std::mutex> lock(worker.mtx_);
+					worker.tasks_.push_back(std::move(fn));
+				}
+
+				pending_.fetch_add(1);
+				{
+					std::lock_guard<std::mutex> lock(sleepMtx_);
+				}
+				sleepCond_.notify_one();
+			}
+
+			void postUI(const TaskFunc& fn)
+			{
+				bool first;
+				{
+					std::lock_guard<std::mutex> lock(uiMtx_);
+					first = ui_.empty();
+					ui_.push_back(fn);
+				}
+				if (first)
+					wake_();
+			}
+
+			// ui thread, runs every queued continuation in one go
+			void drainUI()
+			{
+				std::vector<TaskFunc> batch;
+				{
+					std::lock_guard<std::mutex> lock(uiMtx_);
+					batch.swap(ui_);
+				}
+				for (auto& fn : batch)
+					fn();
+			}
+
+		private:
+			struct Worker
+			{
+				std::mutex mtx_;
+				std::deque<TaskFunc> tasks_;
+				std::thread thread_;
+			};
+
+			static TaskPool*& current()
+			{
+				static thread_local TaskPool* pool = nullptr;
+				return pool;
+			}
+
+			static int& workerIndex()
+			{
+				static thread_local int index = -1;
+				return index;
+			}
+
+			void start()
+			{
+				int count = int(std::thread::hardware_concurrency());
+				if (count < 2)
+					count = 2;
+
+				for (int i = 0; i < count; ++i)
+					workers_.emplace_back(new Worker());
+
+				for (int i = 0; i < count; ++i)
+				{
+					workers_[i]->thread_ = std::thread([=]()
+					{
+						Trace::setThreadName("minui-worker");
+						current() = this;
+						workerIndex() = i;
+						run(i);
+					});
+				}
+			}
+
+			void run(int index)
+			{
+				for (;;)
+				{
+					TaskFunc fn;
+					if (pop(index, fn))
+					{
+						pending_.fetch_sub(1);
+						fn();
+						continue;
+					}
+
+					std::unique_lock<std::mutex> lock(sleepMtx_);
+					sleepCond_.wait(lock, [this]() { return stop_ || pending_.load() > 0; });
+					if (stop_)
+						return;
+				}
+			}
+
+			// newest from own queue first, otherwise steal the oldest from the others
+			bool pop(int index, TaskFunc& fn)
+			{
+				{
+					Worker& own = *workers_[index];
+					std::lock_guard<std::mutex> lock(own.mtx_);
+					if (!own.tasks_.empty())
+					{
+						fn = std::move(own.tasks_.back());
+						own.tasks_.pop_back();
+						return true;
+					}
+				}
+
+				size_t count = workers_.size();
+				for (size_t i = 1; i < count; ++i)
+				{
+					Worker& victim = *workers_[(index + i) % count];
+					std::lock_guard<std::mutex> lock(victim.mtx_);
+					if (!victim.tasks_.empty())
+					{
+						fn = std::move(victim.tasks_.front());
+						victim.tasks_.pop_front();
+						return true;
+					}
+				}
+				return false;
+			}
+
+		private:
+			WakeFunc wake_;
+			std::once_flag started_;
+			std::vector<std::unique_ptr<Worker>> workers_;
+			std::atomic<unsigned> next_{ 0 };
+			std::atomic<int> pending_{ 0 };
+			std::mutex sleepMtx_;
+			std::condition_variable sleepCond_;
+			bool stop_ = false;
+
+			std::mutex uiMtx_;
+			std::vector<TaskFunc> ui_;
+		};
+	}
+
+	// Opt-in latency histograms of ui thread activity. When disabled a probe is one relaxed atomic load.
+	class Metrics
+	{
+	public:
+		enum Metric
+		{
+			RunOnUIQueue, // posted until started on the ui thread
+			RunOnUIExec,
+			Timer,
+			Paint,
+			CssReload,
+			ImageDecode,
+			MetricCount
+		};
+
+		enum { BucketCount = 64 }; // bucket i holds [2^i, 2^(i+1)) ns
+
+		struct Histogram
+		{
+			uint64_t count;
+			uint64_t totalNs;
+			uint64_t maxNs;
+			uint64_t buckets[BucketCount];
+
+			// upper bound of the bucket holding the percentile, at most the max
+			uint64_t percentile(double p) const
+			{
+				uint64_t rank = uint64_t(double(count) * p);
+				uint64_t seen = 0;
+				for (int i = 0; i < BucketCount; ++i)
+				{
+					seen += buckets[i];
+					if (seen > rank)
+						return i < 63 && (uint64_t(2) << i) - 1 < maxNs ? (uint64_t(2) << i) - 1 : maxNs;
+				}
+				return maxNs;
+			}
+		};
+
+		// times a scope when metrics are enabled
+		class Scope
+		{
+		public:
+			explicit Scope(Metric metric)
+				: metric_(metric)
+				, start_(enabled() ? now() : 0)
+			{
+
+			}
+
+			~Scope()
+			{
+				if (start_)
+					record(metric_, now() - start_);
+			}
+
+			Scope(const Scope&) = delete;
+			Scope& operator=(const Scope&) = delete;
+
+		private:
+			Metric metric_;
+			int64_t start_;
+		};
+
+		static const char* name(Metric metric)
+		{
+			static const char* names[MetricCount] = { "run_on_ui_queue", "run_on_ui_exec", "timer", "paint", "css_reload", "image_decode" };
+			return names[metric];
+		}
+
+		static bool enabled()
+		{
+			return instance().enabled_.load(std::memory_order_relaxed);
+		}
+
+		static void setEnabled(bool v)
+		{
+			instance().enabled_.store(v, std::memory_order_relaxed);
+		}
+
+		// dump to out when the process exits
+		static void setDumpOnExit(FILE* out)
+		{
+			instance().dumpOnExit_ = out;
+		}
+
+		static int64_t now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		static void record(Metric metric, int64_t ns)
+		{
+			if (!enabled())
+				return;
+
+			uint64_t value = ns > 0 ? uint64_t(ns) : 0;
+			int bucket = 0;
+			while (bucket < BucketCount - 1 && (value >> (bucket + 1)))
+				bucket++;
+
+			Counters& c = instance().counters_[metric];
+			c.count.fetch_add(1, std::memory_order_relaxed);
+			c.totalNs.fetch_add(value, std::memory_order_relaxed);
+			c.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+
+			uint64_t max = c.maxNs.load(std::memory_order_relaxed);
+			while (value > max && !c.maxNs.compare_exchange_weak(max, value, std::memory_order_relaxed));
+		}
+
+		static Histogram get(Metric metric)
+		{
+			const Counters& c = instance().counters_[metric];
+			Histogram h;
+			h.count = c.count.load(std::memory_order_relaxed);
+			h.totalNs = c.totalNs.load(std::memory_order_relaxed);
+			h.maxNs = c.maxNs.load(std::memory_order_relaxed);
+			for (int i = 0; i < BucketCount; ++i)
+				h.buckets[i] = c.buckets[i].load(std::memory_order_relaxed);
+			return h;
+		}
+
+		static void reset()
+		{
+			for (auto& c : instance().counters_)
+			{
+				c.count = 0;
+				c.totalNs = 0;
+				c.maxNs = 0;
+				for (auto& bucket : c.buckets)
+					bucket = 0;
+			}
+		}
+
+		static void dump(FILE* out)
+		{
+			fprintf(out, "%-16s %10s %12s %12s %12s %12s\n", "metric", "count", "mean(us)", "p50(us)", "p99(us)", "max(us)");
+			for (int i = 0; i < MetricCount; ++i)
+			{
+				Histogram h = get(Metric(i));
+				if (!h.count)
+					continue;
+
+				fprintf(out, "%-16s %10llu %12.1f %12.1f %12.1f %12.1f\n", name(Metric(i)), (unsigned long long)h.count,
+					double(h.totalNs) / double(h.count) / 1000.0, double(h.percentile(0.5)) / 1000.0,
+					double(h.percentile(0.99)) / 1000.0, double(h.maxNs) / 1000.0);
+			}
+		}
+
+	private:
+		struct Counters
+		{
+			std::atomic<uint64_t> count{ 0 };
+			std::atomic<uint64_t> totalNs{ 0 };
+			std::atomic<uint64_t> maxNs{ 0 };
+			std::atomic<uint64_t> buckets[BucketCount];
+
+			Counters()
+			{
+				for (auto& bucket : buckets)
+					bucket = 0;
+			}
+		};
+
+		static Metrics& instance()
+		{
+			static Metrics metrics;
+			return metrics;
+		}
+
+		Metrics() = default;
+
+		~Metrics()
+		{
+			if (dumpOnExit_)
+				dump(dumpOnExit_);
+		}
+
+		std::atomic<bool> enabled_{ false };
+		FILE* dumpOnExit_ = nullptr;
+		Counters counters_[MetricCount];
+	};
+
+	// Property tweens on the ui thread, advanced together once per frame.
+	// The window ticks it from its frame source only while something is animating.
+	class Animator
+	{
+	public:
+		enum Easing
+		{
+			Linear,
+			EaseIn,
+			EaseOut,
+			EaseInOut
+		};
+
+		enum { FrameInterval = 16 }; // ms, where there is no frame clock
+
+		using ApplyFunc = std::function<void(float t)>; // eased, 0 to 1
+
+		static float ease(Easing easing, float t)
+		{
+			float u = 1 - t;
+			switch (easing)
+			{
+			case EaseIn:
+				return t * t * t;
+			case EaseOut:
+				return 1 - u * u * u;
+			case EaseInOut:
+				return t < 0.5f ? 4 * t * t * t : 1 - 4 * u * u * u;
+			default:
+				return t;
+			}
+		}
+
+		static float lerp(float from, float to, float t)
+		{
+			return from + (to - from) * t;
+		}
+
+		template <typename C>
+		static C mix(const C& from, const C& to, float t)
+		{
+			C c = to;
+			c.r = uint8_t(lerp(from.r, to.r, t) + 0.5f);
+			c.g = uint8_t(lerp(from.g, to.g, t) + 0.5f);
+			c.b = uint8_t(lerp(from.b, to.b, t) + 0.5f);
+			return c;
+		}
+
+		// replaces the tween running on the same owner and key, msec <= 0 applies the end at once.
+		// a repeating tween starts over every msec until stopped
+		void start(const void* owner, const void* key, int msec, Easing easing, const ApplyFunc& fn, int64_t now, bool repeat = false)
+		{
+			stop(owner, key);
+			if (msec <= 0)
+			{
+				fn(1);
+				return;
+			}
+			tweens_.push_back(Tween{ owner, key, now, msec, easing, fn, repeat });
+		}
+
+		// key nullptr stops every tween of the owner
+		void stop(const void* owner, const void* key = nullptr)
+		{
+			for (auto& tween : tweens_)
+			{
+				if (tween.owner_ == owner && (!key || tween.key_ == key))
+					tween.owner_ = nullptr; // swept after the frame
+			}
+		}
+
+		bool active() const
+		{
+			return !tweens_.empty();
+		}
+
+		// one batch for every tween, returns whether any is still running
+		bool tick(int64_t now)
+		{
+			Trace::Scope trace("animate");
+
+			// tweens started from callbacks begin next frame, the deque keeps running ones in place
+			size_t count = tweens_.size();
+			for (size_t i = 0; i < count; ++i)
+			{
+				Tween& tween = tweens_[i];
+				if (!tween.owner_)
+					continue;
+
+				int64_t elapsed = now - tween.start_;
+				bool done = elapsed >= tween.duration_;
+				if (done && tween.repeat_)
+				{
+					elapsed %= tween.duration_;
+					tween.start_ = now - elapsed;
+					done = false;
+				}
+				float t = done ? 1.0f : (elapsed > 0 ? float(elapsed) / float(tween.duration_) : 0.0f);
+				if (done)
+					tween.owner_ = nullptr;
+				tween.fn_(ease(tween.easing_, t));
+			}
+
+			size_t live = 0;
+			for (size_t i = 0; i < tweens_.size(); ++i)
+			{
+				if (tweens_[i].owner_)
+				{
+					if (live != i)
+						tweens_[live] = std::move(tweens_[i]);
+					live++;
+				}
+			}
+			tweens_.resize(live);
+			return active();
+		}
+
+	private:
+		struct Tween
+		{
+			const void* owner_;
+			const void* key_;
+			int64_t start_;
+			int duration_;
+			Easing easing_;
+			ApplyFunc fn_;
+			bool repeat_;
+		};
+
+		std::deque<Tween> tweens_;
+	};
+}
+
+// Built-in style rows: X(name, css selector, color r g b, background r g b, radius, font size).
+// Each platform expands them into constexpr Style tables, gtk also into its css text at compile time.
+#define MINUI_STYLES_LIGHT(X) \
+	X("window",            "window",              50,  50,  50,  250, 250, 251, 6, MINUI_FONT_SIZE) \
+	X("label",             ".Label",              50,  50,  50,  250, 250, 251, 6, MINUI_FONT_SIZE) \
+	X("image",             ".image",              50,  50,  50,  250, 250, 251, 6, MINUI_FONT_SIZE) \
+	X("listview",          ".ListView",           50,  50,  50,  250, 250, 251, 6, MINUI_FONT_SIZE) \
+	X("headerbar",         "headerbar",           50,  50,  50,  250, 250, 251, 6, MINUI_FONT_SIZE) \
+	X("button",            ".Button",             50,  50,  50,  230, 230, 230, 6, MINUI_FONT_SIZE) \
+	X("button:hover",      ".Button:hover",       50,  50,  50,  220, 220, 221, 6, MINUI_FONT_SIZE) \
+	X("button:press",      ".Button:active",      50,  50,  50,  190, 190, 192, 6, MINUI_FONT_SIZE) \
+	X("progress",          ".progress",           53,  132, 228, 235, 232, 230, 6, MINUI_FONT_SIZE) \
+	X("CloseButton",       ".CloseButton",        50,  50,  50,  250, 250, 251, 0, MINUI_FONT_SIZE) \
+	X("CloseButton:hover", ".CloseButton:hover",  50,  50,  50,  196, 43,  28,  0, MINUI_FONT_SIZE) \
+	X("CloseButton:press", ".CloseButton:active", 50,  50,  50,  181, 43,  30,  0, MINUI_FONT_SIZE)
+
+#define MINUI_STYLES_DARK(X) \
+	X("window",            "window",              250, 250, 250, 34,  34,  38,  6, MINUI_FONT_SIZE) \
+	X("label",             ".Label",              250, 250, 250, 34,  34,  38,  6, MINUI_FONT_SIZE) \
+	X("image",             ".image",              250, 250, 250, 34,  34,  38,  6, MINUI_FONT_SIZE) \
+	X("listview",          ".ListView",           250, 250, 250, 34,  34,  38,  6, MINUI_FONT_SIZE) \
+	X("headerbar",         "headerbar",           250, 250, 250, 34,  34,  38,  6, MINUI_FONT_SIZE) \
+	X("button",            ".Button",             250, 250, 250, 56,  56,  59,  6, MINUI_FONT_SIZE) \
+	X("button:hover",      ".Button:hover",       250, 250, 250, 67,  67,  70,  6, MINUI_FONT_SIZE) \
+	X("button:press",      ".Button:active",      250, 250, 250, 100, 100, 103, 6, MINUI_FONT_SIZE) \
+	X("progress",          ".progress",           53,  132, 228, 81,  81,  85,  6, MINUI_FONT_SIZE) \
+	X("CloseButton",       ".CloseButton",        250, 250, 250, 34,  34,  38,  0, MINUI_FONT_SIZE) \
+	X("CloseButton:hover", ".CloseButton:hover",  250, 250, 250, 196, 43,  28,  0, MINUI_FONT_SIZE) \
+	X("CloseButton:press", ".CloseButton:active", 250, 250, 250, 181, 43,  30,  0, MINUI_FONT_SIZE)
+
+#define MINUI_STR_(x) #x
+#define MINUI_STR(x) MINUI_STR_(x)
+
+// X for a constexpr Style table, e.g. constexpr Style styles[] = { MY_STYLES(MINUI_STYLE) };
+#define MINUI_STYLE(name, sel, r, g, b, br, bg, bb, radius, size) \
+	minui::Style{ name, minui::Color{ r, g, b, 0 }, minui::Color{ br, bg, bb, 0 }, radius, size, { MINUI_FONT_FAMILY } },
+
+// X for the matching css text, numbers must be literals
+#define MINUI_STYLE_CSS(name, sel, r, g, b, br, bg, bb, radius, size) \
+	sel " {\n" \
+	"\tborder: 0px; outline: none; background-image: none; box-shadow: none; text-shadow: none; \n" \
+	"\tcolor: rgb(" #r "," #g "," #b ");\n" \
+	"\tbackground-color: rgb(" #br "," #bg "," #bb ");\n" \
+	"\tborder-radius: " #radius "px;\n" \
+	"\tfont-size: " MINUI_STR(size) "px;\n" \
+	"\tfont-family: \"" MINUI_FONT_CSS "\";\n" \
+	"\ttransition: " MINUI_CSS_TRANSITION ";\n" \
+	"}\n"
+
+// state changes fade like the Direct-UI Button::TransitionTime
+#define MINUI_CSS_TRANSITION "background-color 120ms ease-out, color 120ms ease-out"
+
+#ifdef MINUI_SOFTWARE
+
+#include <cmath>
+
+#define MINUI_FONT_SIZE 14
+#define MINUI_FONT_FAMILY "sans", NULL
+#define MINUI_FONT_CSS "sans,"
+
+namespace minui
+{
+	class Handle
+	{
+	public:
+		Handle(const Handle&) = delete;
+		Handle& operator=(const Handle&) = delete;
+		Handle(Handle&&) = delete;
+		Handle& operator=(Handle&&) = delete;
+
+	protected:
+		Handle() = default;
+		~Handle() = default;
+	};
+
+#ifdef MINUI_GTK_DIRECT
+	// GTK 4 or 3 and cairo, loaded at runtime. A window is a single drawing area showing the
+	// software framebuffer, widgets never become GTK widgets.
+	namespace gtk
+	{
+		using Callback = void(*)();
+		using SourceFunc = bool(*)(void*);
+		using NotifyFunc = void(*)(void* obj, void* pspec, void* data);
+		using OnCloseFunc = bool(*)(void* self, void* data);
+		using DrawFunc = void(*)(void* cr, void* data);
+		using AreaDrawFunc = void(*)(void* area, void* cr, int width, int height, void* data);
+
+		enum
+		{
+			CONNECT_DEFAULT = 0,
+
+			SOURCE_REMOVE = false,
+			SOURCE_CONTINUE = true,
+
+			POINTER_MOTION_MASK = 1 << 2,
+			BUTTON_PRESS_MASK = 1 << 8,
+			BUTTON_RELEASE_MASK = 1 << 9,
+			LEAVE_NOTIFY_MASK = 1 << 13,
+			BUTTON_PRESS = 4, // GdkEventType, 2BUTTON_PRESS and 3BUTTON_PRESS follow
+			SCROLL_MASK = 1 << 21,
+			SMOOTH_SCROLL_MASK = 1 << 23,
+
+			SCROLL_UP = 0,
+			SCROLL_DOWN = 1,
+			SCROLL_SMOOTH = 4,
+			EVENT_CONTROLLER_SCROLL_VERTICAL = 1,
+
+			CAIRO_FORMAT_RGB24 = 1, // same layout as Color::toPixel()
+			CAIRO_FONT_SLANT_NORMAL = 0,
+			CAIRO_FONT_WEIGHT_NORMAL = 0
+		};
+
+		struct TextExtents
+		{
+			double xBearing;
+			double yBearing;
+			double width;
+			double height;
+			double xAdvance;
+			double yAdvance;
+		};
+
+		struct FontExtents
+		{
+			double ascent;
+			double descent;
+			double height;
+			double maxXAdvance;
+			double maxYAdvance;
+		};
+
+		// pointer input of a drawing area in logical pixels
+		struct PointerHandler
+		{
+			void (*move)(double x, double y, void* data);
+			void (*leave)(void* data);
+			bool (*button)(double x, double y, bool press, void* data); // true on a press moves the window
+			void (*scroll)(double dy, void* data);
+			void* window;
+			void* data;
+		};
+
+		class Library
+		{
+		public:
+			static Library& instance()
+			{
+				static Library lib;
+				return lib;
+			}
+
+			bool initialize()
+			{
+				if (gtk_)
+					return loaded_;
+
+				gtk_ = dlopen("libgtk-4.so.1", RTLD_LAZY);
+				if (!gtk_)
+				{
+					gtk_ = dlopen("libgtk-3.so.0", RTLD_LAZY);
+					if (!gtk_)
+						return false;
+
+					isGtk3_ = true;
+				}
+
+				// cairo and glib come in with gtk
+				#define SYMBOL(p) p = (decltype(p))dlsym(gtk_, #p); if (!p) return false
+				#define SYMBOL_WITH(p, sym) p = (decltype(p))dlsym(gtk_, sym); if (!p) return false
+				#define SYMBOL_SELECT(p, sym4, sym3) p = (decltype(p))dlsym(gtk_, isGtk3_ ? sym3 : sym4); if (!p) return false
+				SYMBOL(g_signal_connect_data);
+				SYMBOL(g_timeout_add);
+				SYMBOL(g_source_remove);
+				SYMBOL(g_main_context_iteration);
+				SYMBOL(g_main_context_wakeup);
+
+				SYMBOL_WITH(gtk_init_, "gtk_init");
+				SYMBOL_WITH(gtk_window_new_, "gtk_window_new");
+				SYMBOL_SELECT(gtk_window_destroy, "gtk_window_destroy", "gtk_widget_destroy");
+				SYMBOL(gtk_window_set_decorated);
+				SYMBOL(gtk_window_set_resizable);
+				SYMBOL(gtk_window_set_title);
+				SYMBOL(gtk_window_set_default_size);
+				SYMBOL_SELECT(gtk_window_set_child, "gtk_window_set_child", "gtk_container_add");
+				SYMBOL_SELECT(gtk_window_present, "gtk_window_present", "gtk_widget_show_all");
+				SYMBOL(gtk_widget_set_visible);
+				SYMBOL(gtk_widget_set_size_request);
+				SYMBOL(gtk_widget_queue_draw);
+				SYMBOL(gtk_widget_get_scale_factor);
+				SYMBOL(gtk_drawing_area_new);
+
+				SYMBOL(cairo_image_surface_create_for_data);
+				SYMBOL(cairo_surface_set_device_scale);
+				SYMBOL(cairo_surface_destroy);
+				SYMBOL(cairo_create);
+				SYMBOL(cairo_destroy);
+				SYMBOL(cairo_set_source_surface);
+				SYMBOL(cairo_set_source_rgb);
+				SYMBOL(cairo_paint);
+				SYMBOL(cairo_rectangle);
+				SYMBOL(cairo_clip);
+				SYMBOL(cairo_select_font_face);
+				SYMBOL(cairo_set_font_size);
+				SYMBOL(cairo_font_extents);
+				SYMBOL(cairo_text_extents);
+				SYMBOL(cairo_move_to);
+				SYMBOL(cairo_show_text);
+
+				if (isGtk3_)
+				{
+					SYMBOL(gtk_widget_add_events);
+					SYMBOL(gdk_event_get_event_type);
+					SYMBOL(gdk_event_get_coords);
+					SYMBOL(gdk_event_get_root_coords);
+					SYMBOL(gdk_event_get_button);
+					SYMBOL(gdk_event_get_time);
+					SYMBOL(gdk_event_get_scroll_direction);
+					SYMBOL(gdk_event_get_scroll_deltas);
+					SYMBOL(gtk_window_begin_move_drag);
+				}
+				else
+				{
+					SYMBOL(gtk_drawing_area_set_draw_func);
+					SYMBOL(gtk_event_controller_motion_new);
+					SYMBOL(gtk_event_controller_scroll_new);
+					SYMBOL(gtk_event_controller_get_current_event_device);
+					SYMBOL(gtk_event_controller_get_current_event_time);
+					SYMBOL(gtk_gesture_click_new);
+					SYMBOL(gtk_widget_add_controller);
+					SYMBOL(gtk_native_get_surface);
+					SYMBOL(gdk_toplevel_begin_move);
+				}
+
+				#undef SYMBOL
+				#undef SYMBOL_WITH
+				#undef SYMBOL_SELECT
+
+				loaded_ = true;
+				return true;
+			}
+
+			// every symbol resolved
+			bool loaded() const
+			{
+				return loaded_;
+			}
+
+		public:
+			#define FUNC(RET, NAME, PARAMS) RET(*NAME)PARAMS = nullptr
+			// glib
+			FUNC(int,  g_signal_connect_data,    (void* obj, const char* sig, Callback callback, void* data, void* destroy, int flags));
+			FUNC(int,  g_timeout_add,            (int interval, SourceFunc fn, void* data));
+			FUNC(bool, g_source_remove,          (int id));
+			FUNC(bool, g_main_context_iteration, (void* context, bool mayBlock));
+			FUNC(void, g_main_context_wakeup,    (void* context));
+
+			// gtk
+			void gtk_init()
+			{
+				using gtk3_init = void(*)(int* argc, char*** argv);
+				using gtk4_init = void(*)();
+				if (isGtk3_)
+					(gtk3_init(gtk_init_))(nullptr, nullptr);
+				else
+					(gtk4_init(gtk_init_))();
+			}
+
+			void* gtk_window_new()
+			{
+				using gtk3_window_new = void*(*)(int);
+				using gtk4_window_new = void*(*)();
+				if (isGtk3_)
+					return (gtk3_window_new(gtk_window_new_))(0);
+				else
+					return (gtk4_window_new(gtk_window_new_))();
+			}
+
+			FUNC(void,  gtk_window_destroy,          (void* win));
+			FUNC(void,  gtk_window_set_decorated,    (void* win, bool v));
+			FUNC(void,  gtk_window_set_resizable,    (void* win, bool v));
+			FUNC(void,  gtk_window_set_title,        (void* win, const char* text));
+			FUNC(void,  gtk_window_set_default_size, (void* win, int width, int height));
+			FUNC(void,  gtk_window_set_child,        (void* win, void* child));
+			FUNC(void,  gtk_window_present,          (void* win));
+			FUNC(void,  gtk_widget_set_visible,      (void* w, bool v));
+			FUNC(void,  gtk_widget_set_size_request, (void* w, int width, int height));
+			FUNC(void,  gtk_widget_queue_draw,       (void* w));
+			FUNC(int,   gtk_widget_get_scale_factor, (void* w));
+			FUNC(void*, gtk_drawing_area_new,        ());
+
+			// cairo
+			FUNC(void*, cairo_image_surface_create_for_data, (uint8_t* data, int format, int width, int height, int stride));
+			FUNC(void,  cairo_surface_set_device_scale, (void* s, double sx, double sy));
+			FUNC(void,  cairo_surface_destroy,  (void* s));
+			FUNC(void*, cairo_create,           (void* s));
+			FUNC(void,  cairo_destroy,          (void* cr));
+			FUNC(void,  cairo_set_source_surface, (void* cr, void* s, double x, double y));
+			FUNC(void,  cairo_set_source_rgb,   (void* cr, double r, double g, double b));
+			FUNC(void,  cairo_paint,            (void* cr));
+			FUNC(void,  cairo_rectangle,        (void* cr, double x, double y, double width, double height));
+			FUNC(void,  cairo_clip,             (void* cr));
+			FUNC(void,  cairo_select_font_face, (void* cr, const char* family, int slant, int weight));
+			FUNC(void,  cairo_set_font_size,    (void* cr, double size));
+			FUNC(void,  cairo_font_extents,     (void* cr, FontExtents* extents));
+			FUNC(void,  cairo_text_extents,     (void* cr, const char* text, TextExtents* extents));
+			FUNC(void,  cairo_move_to,          (void* cr, double x, double y));
+			FUNC(void,  cairo_show_text,        (void* cr, const char* text));
+
+			// gtk4 hands the draw function a cairo context, gtk3 the draw signal
+			void connect_draw(void* area, DrawFunc fn, void* data)
+			{
+				struct DrawArg
+				{
+					DrawFunc fn_;
+					void* data_;
+				};
+				auto arg = new DrawArg{ fn, data };
+
+				if (isGtk3_)
+				{
+					using DrawSignalFunc = bool(*)(void* w, void* cr, void* user);
+					g_signal_connect_data(area, "draw", Callback(DrawSignalFunc([](void* w, void* cr, void* user) -> bool
+					{
+						auto arg = (DrawArg*)user;
+						arg->fn_(cr, arg->data_);
+						return true;
+					})), arg, nullptr, CONNECT_DEFAULT);
+				}
+				else
+				{
+					gtk_drawing_area_set_draw_func(area, AreaDrawFunc([](void* area, void* cr, int width, int height, void* user)
+					{
+						auto arg = (DrawArg*)user;
+						arg->fn_(cr, arg->data_);
+					}), arg, nullptr);
+				}
+			}
+
+			void connect_window_close_request(void* win, OnCloseFunc onClose, void* data)
+			{
+				if (isGtk3_)
+				{
+					struct DeleteEventArg
+					{
+						OnCloseFunc onClose_;
+						void* data_;
+					};
+					auto arg = new DeleteEventArg{ onClose, data };
+
+					using DeleteEventFunc = bool(*)(void* w, void* e, void* user);
+					g_signal_connect_data(win, "delete_event", Callback(DeleteEventFunc([](void* w, void* e, void* user) -> bool
+					{
+						auto arg = (DeleteEventArg*)user;
+						return arg->onClose_(w, arg->data_);
+					})), arg, nullptr, CONNECT_DEFAULT);
+				}
+				else
+				{
+					g_signal_connect_data(win, "close-request", Callback(onClose), data, nullptr, CONNECT_DEFAULT);
+				}
+			}
+
+			// handler must outlive the area
+			void connect_pointer(void* area, PointerHandler* handler)
+			{
+				if (isGtk3_)
+				{
+					using EventFunc = bool(*)(void* w, void* e, void* user);
+					gtk_widget_add_events(area, POINTER_MOTION_MASK | BUTTON_PRESS_MASK | BUTTON_RELEASE_MASK | LEAVE_NOTIFY_MASK | SCROLL_MASK | SMOOTH_SCROLL_MASK);
+
+					g_signal_connect_data(area, "motion-notify-event", Callback(EventFunc([](void* w, void* e, void* user) -> bool
+					{
+						auto h = (PointerHandler*)user;
+						double x = 0, y = 0;
+						instance().gdk_event_get_coords(e, &x, &y);
+						h->move(x, y, h->data);
+						return true;
+					})), handler, nullptr, CONNECT_DEFAULT);
+
+					g_signal_connect_data(area, "leave-notify-event", Callback(EventFunc([](void* w, void* e, void* user) -> bool
+					{
+						auto h = (PointerHandler*)user;
+						h->leave(h->data);
+						return true;
+					})), handler, nullptr, CONNECT_DEFAULT);
+
+					g_signal_connect_data(area, "button-press-event", Callback(EventFunc([](void* w, void* e, void* user) -> bool
+					{
+						auto h = (PointerHandler*)user;
+						Library& lib = instance();
+						unsigned button = 0;
+						double x = 0, y = 0, rootX = 0, rootY = 0;
+						lib.gdk_event_get_button(e, &button);
+						lib.gdk_event_get_coords(e, &x, &y);
+						if (button != 1)
+							return false;
+
+						// a double or triple click also sends 2BUTTON/3BUTTON_PRESS after the plain presses
+						if (lib.gdk_event_get_event_type(e) != BUTTON_PRESS)
+							return true;
+
+						if (h->button(x, y, true, h->data))
+						{
+							// the release goes to the window manager
+							lib.gdk_event_get_root_coords(e, &rootX, &rootY);
+							lib.gtk_window_begin_move_drag(h->window, int(button), int(rootX), int(rootY), lib.gdk_event_get_time(e));
+						}
+						return true;
+					})), handler, nullptr, CONNECT_DEFAULT);
+
+					g_signal_connect_data(area, "button-release-event", Callback(EventFunc([](void* w, void* e, void* user) -> bool
+					{
+						auto h = (PointerHandler*)user;
+						unsigned button = 0;
+						double x = 0, y = 0;
+						instance().gdk_event_get_button(e, &button);
+						instance().gdk_event_get_coords(e, &x, &y);
+						if (button != 1)
+							return false;
+
+						h->button(x, y, false, h->data);
+						return true;
+					})), handler, nullptr, CONNECT_DEFAULT);
+
+					g_signal_connect_data(area, "scroll-event", Callback(EventFunc([](void* w, void* e, void* user) -> bool
+					{
+						auto h = (PointerHandler*)user;
+						int direction = 0;
+						double dx = 0, dy = 0;
+						instance().gdk_event_get_scroll_direction(e, &direction);
+						if (direction == SCROLL_UP) dy = -1;
+						else if (direction == SCROLL_DOWN) dy = 1;
+						else if (direction == SCROLL_SMOOTH) instance().gdk_event_get_scroll_deltas(e, &dx, &dy);
+						h->scroll(dy, h->data);
+						return true;
+					})), handler, nullptr, CONNECT_DEFAULT);
+				}
+				else
+				{
+					using MotionFunc = void(*)(void* ctrl, double x, double y, void* user);
+					using LeaveFunc = void(*)(void* ctrl, void* user);
+					using ClickFunc = void(*)(void* gesture, int count, double x, double y, void* user);
+					using ScrollFunc = bool(*)(void* ctrl, double dx, double dy, void* user);
+
+					void* motion = gtk_event_controller_motion_new();
+					g_signal_connect_data(motion, "motion", Callback(MotionFunc([](void* ctrl, double x, double y, void* user)
+					{
+						auto h = (PointerHandler*)user;
+						h->move(x, y, h->data);
+					})), handler, nullptr, CONNECT_DEFAULT);
+					g_signal_connect_data(motion, "leave", Callback(LeaveFunc([](void* ctrl, void* user)
+					{
+						auto h = (PointerHandler*)user;
+						h->leave(h->data);
+					})), handler, nullptr, CONNECT_DEFAULT);
+					gtk_widget_add_controller(area, motion);
+
+					void* click = gtk_gesture_click_new(); // primary button
+					g_signal_connect_data(click, "pressed", Callback(ClickFunc([](void* gesture, int count, double x, double y, void* user)
+					{
+						auto h = (PointerHandler*)user;
+						Library& lib = instance();
+						if (h->button(x, y, true, h->data))
+						{
+							lib.gdk_toplevel_begin_move(lib.gtk_native_get_surface(h->window), lib.gtk_event_controller_get_current_event_device(gesture),
+								1, x, y, lib.gtk_event_controller_get_current_event_time(gesture));
+						}
+					})), handler, nullptr, CONNECT_DEFAULT);
+					g_signal_connect_data(click, "released", Callback(ClickFunc([](void* gesture, int count, double x, double y, void* user)
+					{
+						auto h = (PointerHandler*)user;
+						h->button(x, y, false, h->data);
+					})), handler, nullptr, CONNECT_DEFAULT);
+					gtk_widget_add_controller(area, click);
+
+					void* scroll = gtk_event_controller_scroll_new(EVENT_CONTROLLER_SCROLL_VERTICAL);
+					g_signal_connect_data(scroll, "scroll", Callback(ScrollFunc([](void* ctrl, double dx, double dy, void* user) -> bool
+					{
+						auto h = (PointerHandler*)user;
+						h->scroll(dy, h->data);
+						return true;
+					})), handler, nullptr, CONNECT_DEFAULT);
+					gtk_widget_add_controller(area, scroll);
+				}
+			}
+
+		private:
+			// gtk3
+			FUNC(void, gtk_widget_add_events,          (void* w, int events));
+			FUNC(int, gdk_event_get_event_type,        (void* e));
+			FUNC(bool, gdk_event_get_coords,           (void* e, double* x, double* y));
+			FUNC(bool, gdk_event_get_root_coords,      (void* e, double* x, double* y));
+			FUNC(bool, gdk_event_get_button,           (void* e, unsigned* button));
+			FUNC(uint32_t, gdk_event_get_time,         (void* e));
+			FUNC(bool, gdk_event_get_scroll_direction, (void* e, int* direction));
+			FUNC(bool, gdk_event_get_scroll_deltas,    (void* e, double* dx, double* dy));
+			FUNC(void, gtk_window_begin_move_drag,     (void* win, int button, int rootX, int rootY, uint32_t time));
+
+			// gtk4
+			FUNC(void,  gtk_drawing_area_set_draw_func, (void* area, AreaDrawFunc fn, void* data, void* destroy));
+			FUNC(void*, gtk_event_controller_motion_new, ());
+			FUNC(void*, gtk_event_controller_scroll_new, (int flags));
+			FUNC(void*, gtk_event_controller_get_current_event_device, (void* ctrl));
+			FUNC(uint32_t, gtk_event_controller_get_current_event_time, (void* ctrl));
+			FUNC(void*, gtk_gesture_click_new, ());
+			FUNC(void,  gtk_widget_add_controller, (void* w, void* ctrl));
+			FUNC(void*, gtk_native_get_surface, (void* native));
+			FUNC(void,  gdk_toplevel_begin_move, (void* toplevel, void* device, int button, double x, double y, uint32_t time));
+
+			// diff
+			void* gtk_init_ = nullptr;
+			void* gtk_window_new_ = nullptr;
+			#undef FUNC
+		private:
+			Library() = default;
+
+			void* gtk_ = nullptr;
+			bool isGtk3_ = false;
+			std::atomic<bool> loaded_{ false }; // read by waking threads
+		};
+
+		inline Library& lib() { return Library::instance(); }
+	}
+#endif
+
+	struct Color
+	{
+		uint8_t r;
+		uint8_t g;
+		uint8_t b;
+		uint8_t _;
+
+		uint32_t toPixel() const
+		{
+			return (uint32_t(r) << 16) | (uint32_t(g) << 8) | uint32_t(b);
+		}
+
+		static Color fromPixel(uint32_t pixel)
+		{
+			return Color{ uint8_t(pixel >> 16), uint8_t(pixel >> 8), uint8_t(pixel), 0 };
+		}
+	};
+
+	struct Point
+	{
+		int x;
+		int y;
+
+		Point scale(float num) const
+		{
+			return { int(float(x) * num), int(float(y) * num) };
+		}
+	};
+
+	struct Rect
+	{
+		int x;
+		int y;
+		int width;
+		int height;
+
+		bool contains(Point pt) const
+		{
+			return x <= pt.x && pt.x <= x + width && y <= pt.y && pt.y < y + height;
+		}
+
+		Rect scale(float num) const
+		{
+			return
+			{
+				int(float(x) * num),
+				int(float(y) * num),
+				int(float(width) * num),
+				int(float(height) * num)
+			};
+		}
+
+		Rect intersect(const Rect& other) const
+		{
+			int x0 = x > other.x ? x : other.x;
+			int y0 = y > other.y ? y : other.y;
+			int x1 = x + width < other.x + other.width ? x + width : other.x + other.width;
+			int y1 = y + height < other.y + other.height ? y + height : other.y + other.height;
+			return { x0, y0, x1 > x0 ? x1 - x0 : 0, y1 > y0 ? y1 - y0 : 0 };
+		}
+
+		// bounding box, empty rects are ignored
+		Rect unite(const Rect& other) const
+		{
+			if (width <= 0 || height <= 0)
+				return other;
+			if (other.width <= 0 || other.height <= 0)
+				return *this;
+
+			int x0 = x < other.x ? x : other.x;
+			int y0 = y < other.y ? y : other.y;
+			int x1 = x + width > other.x + other.width ? x + width : other.x + other.width;
+			int y1 = y + height > other.y + other.height ? y + height : other.y + other.height;
+			return { x0, y0, x1 - x0, y1 - y0 };
+		}
+	};
+
+	struct Style
+	{
+		enum { FontFamilyCount = 6 };
+
+		// fields a derived style overrides, see Theme::setStyle
+		enum Field
+		{
+			ColorField = 1 << 0,
+			BackgroundColorField = 1 << 1,
+			RadiusField = 1 << 2,
+			FontSizeField = 1 << 3,
+			FontFamilyField = 1 << 4,
+			AllFields = (1 << 5) - 1
+		};
+
+		const char* name;
+		Color color;
+		Color backgroundColor;
+		int radius;
+		int fontSize;
+		const char* fontFamily[FontFamilyCount];
+
+		static const Style& defaultStyle(bool isDark = false)
+		{
+			static constexpr Style styles[2] =
+			{
+				// light
+				{
+					"default-light",
+					Color{50, 50, 50},
+					Color{250, 250, 251},
+					6,
+					MINUI_FONT_SIZE,
+					{ MINUI_FONT_FAMILY }
+				},
+				// dark
+				{
+					"default-dark",
+					Color{250, 250, 250},
+					Color{ 34,34,38 },
+					6,
+					MINUI_FONT_SIZE,
+					{ MINUI_FONT_FAMILY }
+				}
+			};
+			return styles[isDark];
+		}
+	};
+
+	// Built-in light and dark styles, read-only tables resolved at compile time.
+	template <typename T = void>
+	struct DefaultStyles
+	{
+		static constexpr Style light[] = { MINUI_STYLES_LIGHT(MINUI_STYLE) };
+		static constexpr Style dark[] = { MINUI_STYLES_DARK(MINUI_STYLE) };
+
+		// not used by Direct-UI, kept for the same Theme declarations on every platform
+		static constexpr const char lightCss[] = MINUI_STYLES_LIGHT(MINUI_STYLE_CSS);
+		static constexpr const char darkCss[] = MINUI_STYLES_DARK(MINUI_STYLE_CSS);
+	};
+
+	template <typename T> constexpr Style DefaultStyles<T>::light[];
+	template <typename T> constexpr Style DefaultStyles<T>::dark[];
+	template <typename T> constexpr const char DefaultStyles<T>::lightCss[];
+	template <typename T> constexpr const char DefaultStyles<T>::darkCss[];
+
+	// A named bundle of styles and themed images, prepared once per theme.
+	// Styles::setTheme() switches bundles by swapping a pointer.
+	class Theme : public Handle, public utils::ThemeBase<Style>
+	{
+	public:
+		explicit Theme(const char* name = nullptr)
+			: ThemeBase(name)
+		{
+		}
+
+		// read-only styles, usually a constexpr table, setStyle() overrides them.
+		// css is the table's pre-rendered text, used by gtk only.
+		template <size_t N>
+		Theme(const char* name, const Style (&table)[N], const char* css = nullptr)
+			: ThemeBase(name, table, int(N))
+		{
+		}
+
+		static Theme& builtin(bool darkMode)
+		{
+			static Theme light("light", DefaultStyles<>::light);
+			static Theme dark("dark", DefaultStyles<>::dark);
+			return darkMode ? dark : light;
+		}
+
+		// styles are read on paint, nothing to render ahead
+		void prepare() {}
+	};
+
+	class Styles : public Handle, public utils::StylesBase<Theme, Style>
+	{
+	public:
+		static Styles& instance()
+		{
+			static Styles styles;
+			return styles;
+		}
+
+		// nullptr goes back to the built-in theme, windows repaint once
+		void setTheme(Theme* theme);
+
+		void update() {}
+
+	private:
+		Styles()
+		{
+
+		}
+	};
+
+	// In-memory framebuffer, 0x00RRGGBB pixels in device units.
+	struct Surface
+	{
+		int width = 0;
+		int height = 0;
+		std::vector<uint32_t> pixels;
+
+		void resize(int w, int h)
+		{
+			width = w;
+			height = h;
+			pixels.assign(size_t(w) * size_t(h), 0);
+		}
+
+		Rect rect() const
+		{
+			return Rect{ 0, 0, width, height };
+		}
+	};
+
+	// BMP pixels decoded in place, bits point into the source data
+	struct Bitmap
+	{
+		int width;
+		int height;
+		int bytes; // per pixel
+		int stride;
+		bool topDown;
+		const uint8_t* bits;
+
+		uint32_t pixel(int x, int y) const
+		{
+			const uint8_t* p = bits + size_t(topDown ? y : height - 1 - y) * stride + size_t(x) * bytes;
+			return (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | uint32_t(p[0]);
+		}
+	};
+
+	// Painter calls of a frame with the device clip each one had, recorded once on the ui thread
+	// and replayed per tile. Tiles only write their own pixels, so they can replay in parallel.
+	class DisplayList
+	{
+	public:
+		enum Op
+		{
+			FillRect,
+			FillRoundRect,
+			RoundRect,
+			Line,
+			Text,
+			Image,
+			BeginOpacity,
+			EndOpacity
+		};
+
+		struct Command
+		{
+			Op op;
+			bool aa;
+			Rect clip; // device
+			Rect rect; // logical, a line keeps its end points here
+			Color color;
+			int radius; // text: align
+			int lineWidth; // text: font size
+			float opacity;
+			uint32_t bitmap; // index in bitmaps_
+			uint32_t text; // offset in the text arena
+		};
+
+		// keeps the memory for the next recording
+		void clear()
+		{
+			commands_.clear();
+			text_.clear();
+			bitmaps_.clear();
+			bounds_ = Rect{ 0 };
+			depth_ = 0;
+			maxDepth_ = 0;
+		}
+
+		size_t size() const
+		{
+			return commands_.size();
+		}
+
+		// device, union of the command clips
+		const Rect& bounds() const
+		{
+			return bounds_;
+		}
+
+		// rasterize the commands into surface, touching only pixels inside tile, temporaries come from arena
+		void replay(Surface& surface, float scale, const Rect& tile, utils::FrameArena& arena) const;
+
+	private:
+		friend class Painter;
+
+		std::vector<Command> commands_;
+		std::vector<char> text_; // nul terminated strings of the text commands
+		std::vector<Bitmap> bitmaps_; // images decoded while recording, tiles only sample them
+		Rect bounds_ = { 0 };
+		int depth_ = 0; // opacity layers open while recording
+		int maxDepth_ = 0;
+	};
+
+	// Software painter with the same interface as the GDI one. Coordinates are logical,
+	// scaled to device pixels. Text has no font rasterizer here, glyphs are drawn as boxes.
+	// A painter with a display list records its calls instead of drawing them.
+	class Painter : public Handle
+	{
+	public:
+		enum TextAlign
+		{
+			AlignCenter,
+			AlignLeft,
+			AlignRight
+		};
+
+		enum { AASamples = 4 }; // per axis
+
+		template <typename F> // F=void(Painter&)
+		void withAA(const Rect& rect, const F& fn) const
+		{
+			Painter painter(surface_, scale_, clip_.intersect(rect.scale(scale_)), true, *arena_);
+			painter.list_ = list_;
+			fn(painter);
+		}
+
+		// F=void(Painter&), what fn paints inside rect is blended over the old pixels
+		template <typename F>
+		void withOpacity(const Rect& rect, float opacity, const F& fn) const
+		{
+			Rect area = clip_.intersect(rect.scale(scale_));
+			Painter painter(surface_, scale_, area, aa_, *arena_);
+			painter.list_ = list_;
+			if (list_)
+			{
+				DisplayList::Command& begin = painter.record(DisplayList::BeginOpacity);
+				begin.opacity = opacity;
+				if (++list_->depth_ > list_->maxDepth_)
+					list_->maxDepth_ = list_->depth_;
+				fn(painter);
+				painter.record(DisplayList::EndOpacity).opacity = opacity;
+				list_->depth_--;
+				return;
+			}
+
+			auto mark = arena_->mark();
+			uint32_t* under = painter.saveUnder(painter.clip_);
+			fn(painter);
+			painter.blendUnder(painter.clip_, opacity, under);
+			arena_->rewind(mark);
+		}
+
+		// scratch memory for this frame, e.g. style names
+		utils::FrameArena& arena() const
+		{
+			return *arena_;
+		}
+
+		// headless only: rounded rects are rasterized once per size, radius and scale and then
+		// filled through their coverage mask, off rasterizes every one again
+		static void setMaskCache(bool enabled)
+		{
+			maskCacheFlag().store(enabled, std::memory_order_relaxed);
+		}
+
+		void drawLine(int x, int y, int x1, int y1, int lineWidth, Color color)
+		{
+			if (list_)
+			{
+				DisplayList::Command& cmd = record(DisplayList::Line);
+				cmd.rect = Rect{ x, y, x1, y1 };
+				cmd.lineWidth = lineWidth;
+				cmd.color = color;
+				return;
+			}
+
+			float ax = x * scale_, ay = y * scale_, bx = x1 * scale_, by = y1 * scale_;
+			float half = lineWidth * scale_ / 2;
+			if (half < 0.5f)
+				half = 0.5f;
+
+			float dx = bx - ax, dy = by - ay;
+			float len2 = dx * dx + dy * dy;
+			Rect box = bounds(fminf(ax, bx) - half, fminf(ay, by) - half, fmaxf(ax, bx) + half, fmaxf(ay, by) + half);
+
+			cover(box, color, [=](float px, float py)
+			{
+				float t = len2 > 0 ? ((px - ax) * dx + (py - ay) * dy) / len2 : 0;
+				t = t < 0 ? 0 : (t > 1 ? 1 : t);
+				float ex = ax + t * dx - px, ey = ay + t * dy - py;
+				return ex * ex + ey * ey <= half * half;
+			});
+		}
+
+		void drawText(const Rect& rect, const utils::String& text, const Style& style, TextAlign align = AlignCenter)
+		{
+			drawText(rect, text.c_str(), style, align);
+		}
+
+		void drawText(const Rect& rect, const char* text, const Style& style, TextAlign align = AlignCenter)
+		{
+			if (!text)
+				return;
+
+			if (list_)
+			{
+				DisplayList::Command& cmd = record(DisplayList::Text);
+				cmd.rect = rect;
+				cmd.text = uint32_t(list_->text_.size());
+				size_t length = strlen(text) + 1;
+				utils::FrameArena::countGrowth(list_->text_, length);
+				list_->text_.insert(list_->text_.end(), text, text + length);
+				cmd.lineWidth = style.fontSize;
+				cmd.radius = align;
+				cmd.color = style.color;
+				return;
+			}
+
+			drawText(rect, text, style.fontSize, style.color, align);
+		}
+
+		void drawImage(const Rect& rect, const uint8_t* bmp, int size)
+		{
+			Bitmap bitmap;
+			{
+				Metrics::Scope scope(Metrics::ImageDecode);
+				Trace::Scope trace("image_decode");
+				if (!decodeBmp(bmp, size, bitmap))
+					return;
+			}
+
+			if (list_)
+			{
+				DisplayList::Command& cmd = record(DisplayList::Image);
+				cmd.rect = rect;
+				cmd.bitmap = uint32_t(list_->bitmaps_.size());
+				utils::FrameArena::countGrowth(list_->bitmaps_, 1);
+				list_->bitmaps_.push_back(bitmap);
+				return;
+			}
+
+			drawBitmap(rect, bitmap);
+		}
+
+		// nearest neighbour scaling of a decoded image
+		void drawBitmap(const Rect& rect, const Bitmap& bitmap)
+		{
+			Rect dst = rect.scale(scale_);
+			Rect area = clip_.intersect(dst);
+			if (dst.width <= 0 || dst.height <= 0)
+				return;
+
+			for (int y = area.y; y < area.y + area.height; ++y)
+			{
+				int sy = (y - dst.y) * bitmap.height / dst.height;
+				uint32_t* line = &surface_.pixels[size_t(y) * surface_.width];
+				for (int x = area.x; x < area.x + area.width; ++x)
+				{
+					int sx = (x - dst.x) * bitmap.width / dst.width;
+					line[x] = bitmap.pixel(sx, sy);
+				}
+			}
+		}
+
+		void frameRect(const Rect& rect, int lineWidth, Color color)
+		{
+			fillRect(Rect{ rect.x, rect.y, rect.width, lineWidth }, color);
+			fillRect(Rect{ rect.x, rect.y + rect.height - lineWidth, rect.width, lineWidth }, color);
+			fillRect(Rect{ rect.x, rect.y, lineWidth, rect.height }, color);
+			fillRect(Rect{ rect.x + rect.width - lineWidth, rect.y, lineWidth, rect.height }, color);
+		}
+
+		void fillRect(const Rect& rect, Color color)
+		{
+			if (list_)
+			{
+				DisplayList::Command& cmd = record(DisplayList::FillRect);
+				cmd.rect = rect;
+				cmd.color = color;
+				return;
+			}
+
+			fill(clip_.intersect(rect.scale(scale_)), color.toPixel());
+		}
+
+		void fillRoundRect(const Rect& rect, int radius, Color color)
+		{
+			if (list_)
+			{
+				DisplayList::Command& cmd = record(DisplayList::FillRoundRect);
+				cmd.rect = rect;
+				cmd.radius = radius;
+				cmd.color = color;
+				return;
+			}
+
+			float x0 = rect.x * scale_, y0 = rect.y * scale_;
+			float x1 = (rect.x + rect.width) * scale_, y1 = (rect.y + rect.height) * scale_;
+			float r = radius * scale_ / 2; // same corner as CreateRoundRectRgn
+			if (maskCache())
+			{
+				coverMask(x0, y0, x1, y1, r, 0, color);
+				return;
+			}
+
+			cover(bounds(x0, y0, x1, y1), color, [=](float px, float py)
+			{
+				return inRoundRect(px, py, x0, y0, x1, y1, r);
+			});
+		}
+
+		void roundRect(const Rect& rect, int lineWidth, int radius, Color color)
+		{
+			if (list_)
+			{
+				DisplayList::Command& cmd = record(DisplayList::RoundRect);
+				cmd.rect = rect;
+				cmd.lineWidth = lineWidth;
+				cmd.radius = radius;
+				cmd.color = color;
+				return;
+			}
+
+			float x0 = rect.x * scale_, y0 = rect.y * scale_;
+			float x1 = (rect.x + rect.width) * scale_, y1 = (rect.y + rect.height) * scale_;
+			float r = radius * scale_ / 2;
+			float w = lineWidth * scale_;
+			if (maskCache())
+			{
+				coverMask(x0, y0, x1, y1, r, w, color);
+				return;
+			}
+
+			cover(bounds(x0, y0, x1, y1), color, [=](float px, float py)
+			{
+				return inRoundRect(px, py, x0, y0, x1, y1, r)
+					&& !inRoundRect(px, py, x0 + w, y0 + w, x1 - w, y1 - w, r > w ? r - w : 0);
+			});
+		}
+
+	private:
+		friend class Window;
+		friend class DisplayList;
+
+		void drawText(const Rect& rect, const char* text, int fontSize, Color textColor, TextAlign align)
+		{
+#ifdef MINUI_GTK_DIRECT
+			if (gtk::lib().loaded())
+			{
+				drawCairoText(rect, text, fontSize, textColor, align);
+				return;
+			}
+#endif
+			// count code points, each one is a box of half the font size
+			int count = 0;
+			for (const char* p = text; *p; ++p)
+				count += (uint8_t(*p) & 0xC0) != 0x80;
+
+			Rect area = rect.scale(scale_);
+			int advance = int(fontSize * scale_ / 2);
+			int glyphHeight = int(fontSize * scale_ * 0.7f);
+			if (advance < 2)
+				advance = 2;
+
+			int width = count * advance;
+			int x = area.x;
+			if (align == AlignCenter)
+				x += (area.width - width) / 2;
+			else if (align == AlignRight)
+				x += area.width - width;
+			int y = area.y + (area.height - glyphHeight) / 2;
+
+			Rect clip = clip_.intersect(area);
+			for (const char* p = text; *p; ++p)
+			{
+				if ((uint8_t(*p) & 0xC0) == 0x80)
+					continue;
+
+				if (*p != ' ')
+					fill(clip.intersect(Rect{ x + 1, y, advance - 2, glyphHeight }), color(textColor));
+				x += advance;
+			}
+		}
+
+#ifdef MINUI_GTK_DIRECT
+		// real glyphs, cairo draws straight into the surface within the clip
+		void drawCairoText(const Rect& rect, const char* text, int fontSize, Color textColor, TextAlign align)
+		{
+			Rect area = rect.scale(scale_);
+			Rect clip = clip_.intersect(area);
+			if (clip.width <= 0 || clip.height <= 0 || !*text)
+				return;
+
+			gtk::Library& lib = gtk::lib();
+			void* target = lib.cairo_image_surface_create_for_data((uint8_t*)surface_.pixels.data(), gtk::CAIRO_FORMAT_RGB24,
+				surface_.width, surface_.height, surface_.width * 4);
+			void* cr = lib.cairo_create(target);
+			lib.cairo_rectangle(cr, clip.x, clip.y, clip.width, clip.height);
+			lib.cairo_clip(cr);
+			lib.cairo_select_font_face(cr, "sans", gtk::CAIRO_FONT_SLANT_NORMAL, gtk::CAIRO_FONT_WEIGHT_NORMAL);
+			lib.cairo_set_font_size(cr, fontSize * scale_);
+
+			gtk::FontExtents font;
+			gtk::TextExtents extents;
+			lib.cairo_font_extents(cr, &font);
+			lib.cairo_text_extents(cr, text, &extents);
+
+			double x = area.x;
+			if (align == AlignCenter)
+				x += (area.width - extents.xAdvance) / 2;
+			else if (align == AlignRight)
+				x += area.width - extents.xAdvance;
+			double y = area.y + (area.height - font.ascent - font.descent) / 2 + font.ascent;
+
+			lib.cairo_set_source_rgb(cr, textColor.r / 255.0, textColor.g / 255.0, textColor.b / 255.0);
+			lib.cairo_move_to(cr, x, y);
+			lib.cairo_show_text(cr, text);
+			lib.cairo_destroy(cr);
+			lib.cairo_surface_destroy(target);
+		}
+#endif
+
+		Painter(Surface& surface, float scale, const Rect& clip, bool aa, utils::FrameArena& arena)
+			: surface_(surface)
+			, clip_(clip.intersect(surface.rect()))
+			, bounds_(clip_)
+			, scale_(scale)
+			, aa_(aa)
+			, arena_(&arena)
+		{
+
+		}
+
+		// within the clip the painter was made with
+		void setClipRect(const Rect& rect)
+		{
+			clip_ = bounds_.intersect(rect.scale(scale_));
+		}
+
+		DisplayList::Command& record(DisplayList::Op op)
+		{
+			utils::FrameArena::countGrowth(list_->commands_, 1);
+			list_->commands_.push_back(DisplayList::Command());
+			list_->bounds_ = list_->bounds_.unite(clip_);
+			DisplayList::Command& cmd = list_->commands_.back();
+			cmd.op = op;
+			cmd.aa = aa_;
+			cmd.clip = clip_;
+			return cmd;
+		}
+
+		// copy of the pixels in area, from the arena
+		uint32_t* saveUnder(const Rect& area) const
+		{
+			uint32_t* under = arena_->allocate<uint32_t>(size_t(area.width) * size_t(area.height));
+			for (int y = 0; y < area.height; ++y)
+				memcpy(&under[size_t(y) * area.width], &surface_.pixels[size_t(area.y + y) * surface_.width + area.x], area.width * sizeof(uint32_t));
+			return under;
+		}
+
+		// what was painted into area since saveUnder() goes over the saved pixels at opacity
+		void blendUnder(const Rect& area, float opacity, const uint32_t* under)
+		{
+			int alpha = int(opacity * 255 + 0.5f);
+			for (int y = 0; y < area.height; ++y)
+			{
+				uint32_t* line = &surface_.pixels[size_t(area.y + y) * surface_.width + area.x];
+				for (int x = 0; x < area.width; ++x)
+					blend(line[x], Color::fromPixel(line[x]), alpha, 255, under[size_t(y) * area.width + x]);
+			}
+		}
+
+		static uint32_t read32(const uint8_t* p)
+		{
+			return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+		}
+
+		static bool decodeBmp(const uint8_t* bmp, int size, Bitmap& bitmap)
+		{
+			if (size < 54 || bmp[0] != 0x42 || bmp[1] != 0x4d)
+				return false;
+
+			uint32_t offset = read32(bmp + 10);
+			int width = int(read32(bmp + 18));
+			int height = int(read32(bmp + 22));
+			int bits = bmp[28] | (bmp[29] << 8);
+			if (bits < 24 || width <= 0 || height == 0)
+				return false;
+
+			bitmap.width = width;
+			bitmap.height = height < 0 ? -height : height;
+			bitmap.topDown = height < 0;
+			bitmap.bytes = bits / 8;
+			bitmap.stride = (width * bitmap.bytes + 3) & ~3;
+			bitmap.bits = bmp + offset;
+			return offset + size_t(bitmap.stride) * bitmap.height <= size_t(size);
+		}
+
+		static bool inRoundRect(float px, float py, float x0, float y0, float x1, float y1, float r)
+		{
+			if (px < x0 || px >= x1 || py < y0 || py >= y1)
+				return false;
+
+			float dx = px < x0 + r ? x0 + r - px : (px > x1 - r ? px - (x1 - r) : 0);
+			float dy = py < y0 + r ? y0 + r - py : (py > y1 - r ? py - (y1 - r) : 0);
+			return dx * dx + dy * dy <= r * r;
+		}
+
+		Rect bounds(float x0, float y0, float x1, float y1) const
+		{
+			Rect rect = { int(floorf(x0)), int(floorf(y0)), 0, 0 };
+			rect.width = int(ceilf(x1)) - rect.x;
+			rect.height = int(ceilf(y1)) - rect.y;
+			return clip_.intersect(rect);
+		}
+
+		uint32_t color(Color c) const
+		{
+			return c.toPixel();
+		}
+
+		void fill(const Rect& area, uint32_t pixel)
+		{
+			for (int y = area.y; y < area.y + area.height; ++y)
+			{
+				uint32_t* line = &surface_.pixels[size_t(y) * surface_.width];
+				for (int x = area.x; x < area.x + area.width; ++x)
+					line[x] = pixel;
+			}
+		}
+
+		void blend(uint32_t& dst, Color color, int coverage, int total)
+		{
+			blend(dst, color, coverage, total, dst);
+		}
+
+		void blend(uint32_t& dst, Color color, int coverage, int total, uint32_t under)
+		{
+			if (coverage == total)
+			{
+				dst = color.toPixel();
+				return;
+			}
+
+			Color old = Color::fromPixel(under);
+			auto mix = [=](uint8_t a, uint8_t b) { return uint8_t((a * coverage + b * (total - coverage)) / total); };
+			dst = Color{ mix(color.r, old.r), mix(color.g, old.g), mix(color.b, old.b), 0 }.toPixel();
+		}
+
+		// Coverage of a rounded rect, filled (w = 0) or stroked, at its offset inside the device pixel grid.
+		// Shapes of the same size, radius and scale share a mask, so repainting one is a masked colour fill.
+		struct Mask
+		{
+			float key[6]; // x0, y0, x1, y1 relative to the box, radius, line width
+			bool aa;
+			int width;
+			int height;
+			std::vector<uint8_t> coverage; // samples inside, per pixel of the box
+		};
+
+		enum { MaskCount = 64 }; // per thread, the oldest is replaced
+
+		static std::atomic<bool>& maskCacheFlag()
+		{
+			static std::atomic<bool> enabled{ true };
+			return enabled;
+		}
+
+		static bool maskCache()
+		{
+			return maskCacheFlag().load(std::memory_order_relaxed);
+		}
+
+		struct MaskCache
+		{
+			Mask slots[MaskCount];
+			int oldest;
+		};
+
+		// rasterizing threads keep their own masks
+		static MaskCache& masks()
+		{
+			static thread_local MaskCache cache = {};
+			return cache;
+		}
+
+		void coverMask(float x0, float y0, float x1, float y1, float r, float w, Color color)
+		{
+			Rect box = { int(floorf(x0)), int(floorf(y0)), 0, 0 };
+			box.width = int(ceilf(x1)) - box.x;
+			box.height = int(ceilf(y1)) - box.y;
+			Rect area = clip_.intersect(box);
+			if (area.width <= 0 || area.height <= 0)
+				return;
+
+			float key[6] = { x0 - box.x, y0 - box.y, x1 - box.x, y1 - box.y, r, w };
+			int samples = aa_ ? AASamples : 1;
+			int total = samples * samples;
+
+			MaskCache& cache = masks();
+			Mask* mask = nullptr;
+			for (Mask& m : cache.slots)
+			{
+				if (m.aa == aa_ && m.width == box.width && m.height == box.height && !memcmp(m.key, key, sizeof(key)))
+				{
+					mask = &m;
+					break;
+				}
+			}
+
+			if (!mask)
+			{
+				mask = &cache.slots[cache.oldest];
+				cache.oldest = (cache.oldest + 1) % MaskCount;
+				memcpy(mask->key, key, sizeof(key));
+				mask->aa = aa_;
+				mask->width = box.width;
+				mask->height = box.height;
+				if (mask->coverage.capacity() < size_t(box.width) * box.height)
+					utils::FrameArena::countAllocation();
+				mask->coverage.assign(size_t(box.width) * box.height, 0);
+
+				// same samples as cover(), relative to the box
+				float step = 1.0f / samples;
+				float ix0 = key[0] + w, iy0 = key[1] + w, ix1 = key[2] - w, iy1 = key[3] - w, ir = r > w ? r - w : 0;
+				for (int y = 0; y < box.height; ++y)
+				{
+					for (int x = 0; x < box.width; ++x)
+					{
+						int coverage = 0;
+						for (int sy = 0; sy < samples; ++sy)
+						{
+							for (int sx = 0; sx < samples; ++sx)
+							{
+								float px = x + (sx + 0.5f) * step, py = y + (sy + 0.5f) * step;
+								coverage += inRoundRect(px, py, key[0], key[1], key[2], key[3], r)
+									&& !(w > 0 && inRoundRect(px, py, ix0, iy0, ix1, iy1, ir));
+							}
+						}
+						mask->coverage[size_t(y) * box.width + x] = uint8_t(coverage);
+					}
+				}
+			}
+
+			for (int y = area.y; y < area.y + area.height; ++y)
+			{
+				uint32_t* line = &surface_.pixels[size_t(y) * surface_.width];
+				const uint8_t* coverage = &mask->coverage[size_t(y - box.y) * box.width];
+				for (int x = area.x; x < area.x + area.width; ++x)
+				{
+					if (coverage[x - box.x])
+						blend(line[x], color, coverage[x - box.x], total);
+				}
+			}
+		}
+
+		// F=bool(float x, float y), inside test in device units, supersampled when anti-aliasing
+		template <typename F>
+		void cover(const Rect& area, Color color, const F& inside)
+		{
+			int samples = aa_ ? AASamples : 1;
+			int total = samples * samples;
+			float step = 1.0f / samples;
+
+			for (int y = area.y; y < area.y + area.height; ++y)
+			{
+				uint32_t* line = &surface_.pixels[size_t(y) * surface_.width];
+				for (int x = area.x; x < area.x + area.width; ++x)
+				{
+					int coverage = 0;
+					for (int sy = 0; sy < samples; ++sy)
+						for (int sx = 0; sx < samples; ++sx)
+							coverage += inside(x + (sx + 0.5f) * step, y + (sy + 0.5f) * step);
+
+					if (coverage)
+						blend(line[x], color, coverage, total);
+				}
+			}
+		}
+
+	private:
+		Surface& surface_;
+		Rect clip_; // device units
+		Rect bounds_;
+		float scale_;
+		bool aa_;
+		DisplayList* list_ = nullptr; // recording when set
+		utils::FrameArena* arena_;
+	};
+
+	inline void DisplayList::replay(Surface& surface, float scale, const Rect& tile, utils::FrameArena& arena) const
+	{
+		struct Layer
+		{
+			Rect area;
+			uint32_t* under;
+		};
+
+		Rect area = bounds_.intersect(tile);
+		if (area.width <= 0 || area.height <= 0)
+			return;
+
+		auto mark = arena.mark();
+		Layer* layers = arena.allocate<Layer>(maxDepth_);
+		int depth = 0;
+
+		for (size_t i = 0; i < commands_.size(); ++i)
+		{
+			const Command& cmd = commands_[i];
+			Rect clip = cmd.clip.intersect(tile);
+			if ((clip.width <= 0 || clip.height <= 0) && cmd.op != BeginOpacity && cmd.op != EndOpacity)
+				continue;
+
+			Painter painter(surface, scale, clip, cmd.aa, arena);
+			switch (cmd.op)
+			{
+			case FillRect:
+				// a run of fills with the same color is one batch
+				painter.fill(clip.intersect(cmd.rect.scale(scale)), cmd.color.toPixel());
+				for (; i + 1 < commands_.size(); ++i)
+				{
+					const Command& next = commands_[i + 1];
+					if (next.op != FillRect || next.color.toPixel() != cmd.color.toPixel())
+						break;
+					painter.fill(next.clip.intersect(tile).intersect(next.rect.scale(scale)), cmd.color.toPixel());
+				}
+				break;
+			case FillRoundRect:
+				painter.fillRoundRect(cmd.rect, cmd.radius, cmd.color);
+				break;
+			case RoundRect:
+				painter.roundRect(cmd.rect, cmd.lineWidth, cmd.radius, cmd.color);
+				break;
+			case Line:
+				painter.drawLine(cmd.rect.x, cmd.rect.y, cmd.rect.width, cmd.rect.height, cmd.lineWidth, cmd.color);
+				break;
+			case Text:
+				painter.drawText(cmd.rect, &text_[cmd.text], cmd.lineWidth, cmd.color, Painter::TextAlign(cmd.radius));
+				break;
+			case Image:
+				painter.drawBitmap(cmd.rect, bitmaps_[cmd.bitmap]);
+				break;
+			case BeginOpacity:
+				layers[depth++] = Layer{ painter.clip_, painter.saveUnder(painter.clip_) };
+				break;
+			case EndOpacity:
+				depth--;
+				painter.blendUnder(layers[depth].area, cmd.opacity, layers[depth].under);
+				break;
+			}
+		}
+		arena.rewind(mark);
+	}
+
+	class Window;
+
+	class Widget : public Handle
+	{
+	public:
+		using OnDrawFunc = std::function<void(Painter&)>;
+
+		virtual ~Widget();
+
+		const char* styleName() const
+		{
+			return name_;
+		}
+
+		void setStyleName(const char* name)
+		{
+			name_ = name;
+			update();
+		}
+
+		const Rect& rect() const
+		{
+			return rect_;
+		}
+
+		void setRect(const Rect& rect)
+		{
+			repaint(); // old place
+			rect_ = rect;
+			layoutChanged();
+			repaint();
+		}
+
+		bool visible() const
+		{
+			return visible_;
+		}
+
+		void setVisible(bool v)
+		{
+			visible_ = v;
+			layoutChanged();
+			repaint();
+		}
+
+		float opacity() const
+		{
+			return opacity_;
+		}
+
+		// 0 is transparent and not painted, msec > 0 fades from the current opacity
+		void setOpacity(float opacity, int msec = 0);
+
+		void update();
+
+	protected:
+		Widget() = default;
+
+		// fn runs on every frame until msec elapsed, starting the same key again replaces it
+		void animate(const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat = false);
+
+		virtual void draw(Painter& painter) {}
+		virtual void mouseMove(bool leave) {}
+		virtual void mouseButton(bool press) {}
+		virtual void mouseWheel(int delta) {}
+
+	private:
+		friend class Window;
+		void setWindow(Window* win)
+		{
+			window_ = win;
+			recorded_ = false;
+		}
+
+		void layoutChanged();
+		void repaint(); // own rect, visible or not
+
+		void setOnDraw(const OnDrawFunc& fn)
+		{
+			onDraw_ = fn;
+			update();
+		}
+
+		void onDraw(Painter& painter)
+		{
+			if (visible_)
+			{
+				draw(painter);
+				if (onDraw_)
+					onDraw_(painter);
+			}
+		}
+
+	private:
+		Rect rect_ = { 0 };
+		const char* name_ = nullptr;
+		Window* window_ = nullptr;
+		OnDrawFunc onDraw_;
+		float opacity_ = 1.0f;
+		bool visible_ = true;
+		bool recorded_ = false; // list_ is up to date
+		DisplayList list_; // draw calls, replayed until the widget is invalidated
+	};
+
+	class Button;
+
+	class Window : public Handle
+	{
+	public:
+		enum
+		{
+			TimerCount = 32,
+			WidgetCount = 256,
+			TileSize = 128, // device px
+			ParallelArea = 256 * 256 // device px, smaller repaints stay on the ui thread
+		};
+
+		using TimerFunc = std::function<bool()>;
+		using OnCloseFunc = std::function<void()>;
+
+		Window() = default;
+		~Window();
+
+		bool create();
+
+		const char* title() const
+		{
+			return title_.c_str();
+		}
+
+		void setTitle(const char* text)
+		{
+			title_ = text;
+#ifdef MINUI_GTK_DIRECT
+			if (handle_)
+				gtk::lib().gtk_window_set_title(handle_, text);
+#endif
+		}
+
+		void setSize(int width, int height)
+		{
+			rect_ = Rect{ 0, 0, width, height };
+#ifdef MINUI_GTK_DIRECT
+			if (handle_)
+			{
+				gtk::lib().gtk_window_set_default_size(handle_, width, height);
+				gtk::lib().gtk_widget_set_size_request(area_, width, height);
+			}
+#endif
+			resize();
+		}
+
+		bool addWidget(Widget* w)
+		{
+			if (widgetIndex_ < WidgetCount)
+			{
+				widgets_[widgetIndex_++] = w;
+				w->setWindow(this);
+				layoutDirty_ = true;
+				update();
+				return true;
+			}
+			return false;
+		}
+
+		bool addTimer(int msec, const TimerFunc& fn);
+
+		void show();
+
+		// repaint and re-record everything
+		void update()
+		{
+			dirty_ = true;
+			dirtyRect_ = surface_.rect();
+			recordAll_ = true;
+		}
+
+		void close()
+		{
+			shown_ = false;
+#ifdef MINUI_GTK_DIRECT
+			if (handle_)
+				gtk::lib().gtk_widget_set_visible(handle_, false);
+#endif
+		}
+
+		void setOnClose(const OnCloseFunc fn)
+		{
+			onClose_ = fn;
+		}
+
+		void setCloseable(bool v);
+
+		// headless only: device scale, framebuffer and input injection
+
+		float scale() const
+		{
+			return scale_;
+		}
+
+		void setScale(float scale)
+		{
+			scale_ = scale;
+			resize();
+		}
+
+		bool visible() const
+		{
+			return shown_;
+		}
+
+		// paint into the framebuffer if anything changed, returns whether it painted
+		bool render()
+		{
+			if (!dirty_ || !shown_)
+				return false;
+
+			dirty_ = false;
+			{
+				Metrics::Scope scope(Metrics::Paint);
+				Trace::Scope trace("paint");
+				onPaint(surface_.rect().intersect(dirtyRect_));
+			}
+			dirtyRect_ = Rect{ 0 };
+			frameCount_++;
+#ifdef MINUI_GTK_DIRECT
+			if (area_)
+				gtk::lib().gtk_widget_queue_draw(area_);
+#endif
+			return true;
+		}
+
+		const Surface& surface() const
+		{
+			return surface_;
+		}
+
+		// device pixel
+		Color pixel(int x, int y) const
+		{
+			if (x < 0 || y < 0 || x >= surface_.width || y >= surface_.height)
+				return Color{ 0 };
+			return Color::fromPixel(surface_.pixels[size_t(y) * surface_.width + x]);
+		}
+
+		int frameCount() const
+		{
+			return frameCount_;
+		}
+
+		// device pixel, moves are coalesced and the last one is delivered by the next frame
+		void injectMouseMove(Point pt)
+		{
+			pointer_ = pt;
+			movePending_ = true;
+		}
+
+		void injectMouseLeave()
+		{
+			movePending_ = false;
+			onMouseMove(Point{ 0, 0 }, true);
+		}
+
+		void injectMouseButton(bool press)
+		{
+			flushInput();
+			if (mouseWidget_)
+				mouseWidget_->mouseButton(press);
+		}
+
+		// deliver the pending move now, iterate() does it once per frame
+		void flushInput()
+		{
+			if (movePending_)
+			{
+				movePending_ = false;
+				onMouseMove(pointer_, false);
+			}
+		}
+
+		void injectMouseWheel(int delta)
+		{
+			if (mouseWidget_)
+				mouseWidget_->mouseWheel(delta);
+		}
+
+		void injectClose()
+		{
+			if (onClose_)
+				onClose_();
+		}
+
+	private:
+		friend class Application;
+		friend class Widget;
+
+		struct Timer
+		{
+			TimerFunc fn_;
+			int interval_;
+			int64_t due_;
+			bool active_;
+		};
+
+		// the widget is going away, drop it with its tweens
+		void detach(Widget* w)
+		{
+			animator_.stop(w);
+			if (mouseWidget_ == w)
+				mouseWidget_ = nullptr;
+			for (int i = 0; i < widgetIndex_; ++i)
+			{
+				if (widgets_[i] == w)
+				{
+					memmove(&widgets_[i], &widgets_[i + 1], (widgetIndex_ - i - 1) * sizeof(Widget*));
+					widgetIndex_--;
+					layoutDirty_ = true;
+					break;
+				}
+			}
+		}
+
+		void animate(const Widget* owner, const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat);
+
+		void resize()
+		{
+			surface_.resize(int(rect_.width * scale_), int(rect_.height * scale_));
+			layoutDirty_ = true;
+			update();
+		}
+
+		// topmost visible widget under the device point, -1 if none
+		int hitTest(Point pt)
+		{
+			if (layoutDirty_)
+			{
+				layoutDirty_ = false;
+				grid_.reset(surface_.width, surface_.height);
+				for (int i = 0; i < widgetIndex_; ++i)
+				{
+					Widget* widget = widgets_[i];
+					Rect rect = widget->visible() ? widget->rect().scale(scale_) : Rect{ 0 };
+					grid_.add(rect.x, rect.y, rect.width, rect.height);
+				}
+				grid_.build();
+			}
+			return grid_.find(pt.x, pt.y);
+		}
+
+		// logical, the rect and a pixel around it for rounding
+		void invalidate(const Rect& rect)
+		{
+			Rect area = rect.scale(scale_);
+			dirtyRect_ = dirtyRect_.unite(Rect{ area.x - 1, area.y - 1, area.width + 2, area.height + 2 });
+			dirty_ = true;
+		}
+
+		// re-record the invalidated widgets, then rasterize the dirty area from all lists
+		void onPaint(const Rect& dirty)
+		{
+			if (dirty.width <= 0 || dirty.height <= 0)
+				return;
+
+			arena_.reset();
+			{
+				Trace::Scope trace("record");
+				if (recordAll_)
+				{
+					auto style = Styles::instance().getStyle("window");
+
+					list_.clear();
+					Painter painter(surface_, scale_, surface_.rect(), false, arena_);
+					painter.list_ = &list_;
+					painter.fillRect(rect_, style.backgroundColor);
+				}
+
+				for (int i = 0; i < widgetIndex_; ++i)
+				{
+					if (recordAll_ || !widgets_[i]->recorded_)
+						record(widgets_[i]);
+				}
+				recordAll_ = false;
+			}
+
+			rasterize(dirty);
+		}
+
+		void record(Widget* widget)
+		{
+			widget->list_.clear();
+			widget->recorded_ = true;
+			if (widget->opacity_ <= 0)
+				return;
+
+			Painter painter(surface_, scale_, surface_.rect(), false, arena_);
+			painter.list_ = &widget->list_;
+			painter.setClipRect(widget->rect());
+			if (widget->opacity_ < 1)
+				painter.withOpacity(widget->rect(), widget->opacity_, [=](Painter& p) { widget->onDraw(p); });
+			else
+				widget->onDraw(painter);
+		}
+
+		// background, then the widgets in order, clipped to area
+		void replay(const Rect& area)
+		{
+			utils::FrameArena& arena = tileArena();
+			list_.replay(surface_, scale_, area, arena);
+			for (int i = 0; i < widgetIndex_; ++i)
+				widgets_[i]->list_.replay(surface_, scale_, area, arena);
+		}
+
+		// one per rasterizing thread, a replay gives back all it takes
+		static utils::FrameArena& tileArena()
+		{
+			static thread_local utils::FrameArena arena;
+			return arena;
+		}
+
+		void rasterize(const Rect& dirty);
+
+#ifdef MINUI_GTK_DIRECT
+		// an undecorated gtk window holding one drawing area that shows surface_
+		bool createNative()
+		{
+			gtk::Library& lib = gtk::lib();
+			handle_ = lib.gtk_window_new();
+			if (!handle_)
+				return false;
+
+			area_ = lib.gtk_drawing_area_new();
+			lib.gtk_window_set_decorated(handle_, false);
+			lib.gtk_window_set_resizable(handle_, false);
+			lib.gtk_window_set_child(handle_, area_);
+
+			lib.connect_draw(area_, [](void* cr, void* data)
+			{
+				((Window*)data)->onNativeDraw(cr);
+			}, this);
+
+			lib.connect_window_close_request(handle_, [](void* self, void* data) -> bool
+			{
+				((Window*)data)->injectClose();
+				return true;
+			}, this);
+
+			lib.g_signal_connect_data(area_, "notify::scale-factor", gtk::Callback(gtk::NotifyFunc([](void* obj, void* pspec, void* data)
+			{
+				Window* window = (Window*)data;
+				window->setScale(float(gtk::lib().gtk_widget_get_scale_factor(window->area_)));
+			})), this, nullptr, gtk::CONNECT_DEFAULT);
+
+			// gtk reports logical pixels, the widgets take device pixels
+			pointerHandler_.move = [](double x, double y, void* data)
+			{
+				Window* window = (Window*)data;
+				window->injectMouseMove(Point{ int(x * window->scale_), int(y * window->scale_) });
+			};
+			pointerHandler_.leave = [](void* data)
+			{
+				((Window*)data)->injectMouseLeave();
+			};
+			pointerHandler_.button = [](double x, double y, bool press, void* data) -> bool
+			{
+				return ((Window*)data)->onNativeButton(Point{ int(x), int(y) }, press);
+			};
+			pointerHandler_.scroll = [](double dy, void* data)
+			{
+				((Window*)data)->onNativeScroll(dy);
+			};
+			pointerHandler_.window = handle_;
+			pointerHandler_.data = this;
+			lib.connect_pointer(area_, &pointerHandler_);
+
+			scale_ = float(lib.gtk_widget_get_scale_factor(area_));
+			return true;
+		}
+
+		// the frame is already painted, hand it to gtk at the device scale
+		void onNativeDraw(void* cr)
+		{
+			if (surface_.width <= 0 || surface_.height <= 0)
+				return;
+
+			gtk::Library& lib = gtk::lib();
+			void* image = lib.cairo_image_surface_create_for_data((uint8_t*)surface_.pixels.data(), gtk::CAIRO_FORMAT_RGB24,
+				surface_.width, surface_.height, surface_.width * 4);
+			lib.cairo_surface_set_device_scale(image, scale_, scale_);
+			lib.cairo_set_source_surface(cr, image, 0, 0);
+			lib.cairo_paint(cr);
+			lib.cairo_surface_destroy(image);
+		}
+
+		// logical point, true to let the window manager move the window
+		bool onNativeButton(Point pt, bool press)
+		{
+			Point device = { int(pt.x * scale_), int(pt.y * scale_) };
+			if (press && Rect{ 0, 0, rect_.width - 48, 32 }.contains(pt) && hitTest(device) < 0)
+				return true;
+
+			injectMouseMove(device);
+			injectMouseButton(press);
+			return false;
+		}
+
+		void onNativeScroll(double dy);
+#endif
+
+		void onMouseMove(Point pt, bool leave)
+		{
+			if (leave)
+			{
+				if (mouseWidget_)
+					mouseWidget_->mouseMove(true);
+				mouseWidget_ = nullptr;
+				return;
+			}
+
+			int hit = hitTest(pt);
+			if (hit >= 0)
+			{
+				Widget* widget = widgets_[hit];
+				if (mouseWidget_ && widget != mouseWidget_)
+					mouseWidget_->mouseMove(true); // mouse leave
+				widget->mouseMove(false);
+				mouseWidget_ = widget;
+				return;
+			}
+
+			if (mouseWidget_)
+			{
+				mouseWidget_->mouseMove(true); // mouse leave
+				mouseWidget_ = nullptr;
+			}
+		}
+
+		void fireTimers(int64_t now)
+		{
+			for (int i = 0; i < timerIndex_; ++i)
+			{
+				Timer& timer = timers_[i];
+				if (timer.active_ && timer.due_ <= now)
+				{
+					// once per pass, periods missed during a stall are skipped rather than fired back to back
+					timer.due_ += ((now - timer.due_) / timer.interval_ + 1) * timer.interval_;
+					Metrics::Scope scope(Metrics::Timer);
+					Trace::Scope trace("timer");
+					if (timer.fn_())
+						timer.active_ = false;
+				}
+			}
+		}
+
+		int64_t nextDue(int64_t due) const
+		{
+			for (int i = 0; i < timerIndex_; ++i)
+			{
+				if (timers_[i].active_ && timers_[i].due_ < due)
+					due = timers_[i].due_;
+			}
+			return due;
+		}
+
+		utils::String title_;
+		Rect rect_ = { 0 };
+		Surface surface_;
+		Button* close_ = nullptr;
+		int timerIndex_ = 0;
+		int widgetIndex_ = 0;
+		int frameCount_ = 0;
+		float scale_ = 1.0;
+		bool dirty_ = true;
+		bool shown_ = false;
+		OnCloseFunc onClose_;
+		Timer timers_[TimerCount];
+		Widget* widgets_[WidgetCount];
+		Widget* mouseWidget_ = nullptr;
+		Animator animator_;
+		utils::HitGrid grid_; // widgets in device pixels
+		bool layoutDirty_ = true;
+		Point pointer_ = { 0, 0 };
+		bool movePending_ = false;
+		Rect dirtyRect_ = { 0 }; // device
+		DisplayList list_; // background
+		bool recordAll_ = true; // size, scale or styles changed
+		utils::FrameArena arena_; // recording temporaries, reset every frame
+#ifdef MINUI_GTK_DIRECT
+		void* handle_ = nullptr;
+		void* area_ = nullptr; // GtkDrawingArea
+		gtk::PointerHandler pointerHandler_ = {};
+		double wheel_ = 0; // partial notches of smooth scrolling
+#endif
+	};
+
+	inline Widget::~Widget()
+	{
+		if (window_)
+			window_->detach(this);
+	}
+
+	inline void Widget::layoutChanged()
+	{
+		if (window_)
+			window_->layoutDirty_ = true;
+	}
+
+	inline void Widget::update()
+	{
+		recorded_ = false;
+		if (window_ && visible_)
+			window_->invalidate(rect_);
+	}
+
+	inline void Widget::repaint()
+	{
+		recorded_ = false;
+		if (window_)
+			window_->invalidate(rect_);
+	}
+
+	inline void Widget::animate(const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat)
+	{
+		if (window_)
+			window_->animate(this, key, msec, easing, fn, repeat);
+		else
+			fn(1);
+	}
+
+	inline void Widget::setOpacity(float opacity, int msec)
+	{
+		float from = opacity_;
+		animate(&opacity_, msec, Animator::EaseOut, [=](float t)
+		{
+			opacity_ = Animator::lerp(from, opacity, t);
+			update();
+		});
+	}
+
+	// Manual event loop: iterate() runs one frame, advance() moves the virtual clock timers run on.
+	// pump() waits in real time and runs a frame, exec() pumps until quit().
+	class Application : public Handle
+	{
+	public:
+		// both mean the same here, the thread calling initialize() is the ui thread
+		enum Loop
+		{
+			OwnThread,
+			HostThread
+		};
+
+		static bool initialize(const char* appId, Loop loop = OwnThread)
+		{
+#ifdef MINUI_GTK_DIRECT
+			if (!gtk::lib().initialize())
+				return false;
+			gtk::lib().gtk_init();
+#endif
+			instance().ui_ = std::this_thread::get_id();
+			instance().quit_ = false;
+			instance().last_ = std::chrono::steady_clock::now();
+			Trace::setThreadName("minui-ui");
+			setStyles(isDarkMode());
+			return true;
+		}
+
+		static void exec()
+		{
+			instance().last_ = std::chrono::steady_clock::now();
+			while (pump(-1));
+		}
+
+		// wait up to timeout ms (-1 for no limit) for queued work, the next timer or animation frame,
+		// move the clock by the real time passed and run a frame. Returns false once after quit().
+		static bool pump(int timeout)
+		{
+			Application& app = instance();
+
+			int64_t due = app.clock_ + MaxWait;
+			for (auto window : app.windows_)
+			{
+				due = window->nextDue(due);
+				if (window->animator_.active() && app.clock_ + Animator::FrameInterval < due)
+					due = app.clock_ + Animator::FrameInterval;
+				if (window->dirty_ && window->shown_)
+					due = app.clock_;
+			}
+			int64_t wait = due - app.clock_;
+			if (timeout >= 0 && timeout < wait)
+				wait = timeout;
+
+#ifdef MINUI_GTK_DIRECT
+			app.waitNative(wait);
+#else
+			{
+				std::unique_lock<std::mutex> lock(app.mtx_);
+				app.cond_.wait_for(lock, std::chrono::milliseconds(wait > 0 ? wait : 0), [&]()
+				{
+					return app.quit_ || app.woken_ || app.pending();
+				});
+			}
+#endif
+
+			auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - app.last_);
+			app.last_ += elapsed;
+			app.clock_ += elapsed.count();
+
+			iterate();
+			return !app.quit_.exchange(false);
+		}
+
+		static void quit()
+		{
+			Application& app = instance();
+			std::lock_guard<std::mutex> lock(app.mtx_);
+			app.quit_ = true;
+			app.cond_.notify_all();
+			wakeNative();
+		}
+
+		// ui thread: run pending calls by lane and continuations, the last pointer move, due timers, animations,
+		// then paint changed windows
+		static bool iterate()
+		{
+			Application& app = instance();
+			{
+				std::lock_guard<std::mutex> lock(app.mtx_);
+				app.woken_ = false;
+			}
+			app.runLane(High, -1);
+			app.runLane(Normal, -1);
+			app.runLane(Bulk, BulkBudget);
+
+			pool().drainUI();
+
+			for (size_t i = 0; i < app.windows_.size(); ++i)
+				app.windows_[i]->flushInput();
+
+			for (size_t i = 0; i < app.windows_.size(); ++i)
+				app.windows_[i]->fireTimers(app.clock_);
+
+			for (size_t i = 0; i < app.windows_.size(); ++i)
+			{
+				if (app.windows_[i]->animator_.active())
+					app.windows_[i]->animator_.tick(app.clock_);
+			}
+
+			bool painted = false;
+			for (size_t i = 0; i < app.windows_.size(); ++i)
+				painted |= app.windows_[i]->render();
+			return painted;
+		}
+
+		// move the virtual clock and run one frame
+		static bool advance(int msec)
+		{
+			instance().clock_ += msec;
+			return iterate();
+		}
+
+		// virtual clock, ms
+		static int64_t now()
+		{
+			return instance().clock_;
+		}
+
+		// switch to the built-in light or dark theme
+		static void setStyles(bool darkMode)
+		{
+			Styles::instance().setTheme(&Theme::builtin(darkMode));
+		}
+
+		// fill a theme bundle with the built-in styles
+		static void setStyles(Theme& theme, bool darkMode)
+		{
+			const auto& table = darkMode ? DefaultStyles<>::dark : DefaultStyles<>::light;
+			for (const Style& style : table)
+				theme.setStyle(style.name, style);
+		}
+
+		static bool isDarkMode()
+		{
+			return instance().dark_.load(std::memory_order_relaxed);
+		}
+
+		using OnThemeChangedFunc = std::function<void(bool darkMode)>;
+
+		static void setOnThemeChanged(const OnThemeChangedFunc& fn)
+		{
+			instance().onThemeChanged_ = fn;
+		}
+
+		// headless only: simulate a system theme switch, ui thread
+		static void setDarkMode(bool dark)
+		{
+			Application& app = instance();
+			if (app.dark_.exchange(dark) != dark && app.onThemeChanged_)
+				app.onThemeChanged_(dark);
+		}
+
+		using RunFunc = std::function<void()>;
+
+		enum Lane
+		{
+			Normal,
+			High, // input feedback, close, page switch: ahead of everything else queued
+			Bulk, // log appends, list refreshes: BulkBudget ms per frame, the rest waits for the next one
+			LaneCount
+		};
+
+		static void runOnUI(const RunFunc& fn, Lane lane = Normal)
+		{
+			Application& app = instance();
+			if (std::this_thread::get_id() == app.ui_)
+			{
+				fn();
+				return;
+			}
+
+			RunContext ctx;
+			ctx.run_ = fn;
+			ctx.posted_ = Metrics::enabled() ? Metrics::now() : 0;
+
+			std::unique_lock<std::mutex> lock(app.mtx_);
+			app.lanes_[lane].push_back(&ctx);
+			app.cond_.notify_all();
+			wakeNative();
+			Trace::Scope trace("runOnUI_wait");
+			app.doneCond_.wait(lock, [&]() { return ctx.done_; });
+		}
+
+		using Task = utils::TaskPool::Task;
+
+		// fn runs on a worker thread, chain thenOnUI() to continue on the ui thread
+		static Task submit(const RunFunc& fn)
+		{
+			return pool().submit(fn);
+		}
+
+	private:
+		friend class Window;
+		friend class Styles;
+
+		enum
+		{
+			MaxWait = 100, // ms
+			BulkBudget = 4 // ms
+		};
+
+		struct RunContext
+		{
+			RunFunc run_;
+			int64_t posted_ = 0;
+			bool done_ = false;
+		};
+
+		// mtx_ held
+		bool pending() const
+		{
+			for (auto& lane : lanes_)
+			{
+				if (!lane.empty())
+					return true;
+			}
+			return false;
+		}
+
+		// run the calls queued in a lane, stop after budget ms (-1 for all) and keep the rest queued in order
+		void runLane(Lane lane, int budget)
+		{
+			std::deque<RunContext*> calls;
+			{
+				std::lock_guard<std::mutex> lock(mtx_);
+				calls.swap(lanes_[lane]);
+			}
+
+			int64_t end = Metrics::now() + int64_t(budget) * 1000000;
+			while (!calls.empty())
+			{
+				if (budget >= 0 && Metrics::now() >= end)
+				{
+					std::lock_guard<std::mutex> lock(mtx_);
+					lanes_[lane].insert(lanes_[lane].begin(), calls.begin(), calls.end());
+					break;
+				}
+
+				RunContext* ctx = calls.front();
+				calls.pop_front();
+				if (ctx->posted_)
+					Metrics::record(Metrics::RunOnUIQueue, Metrics::now() - ctx->posted_);
+				{
+					Metrics::Scope scope(Metrics::RunOnUIExec);
+					Trace::Scope trace("runOnUI");
+					ctx->run_();
+				}
+
+				bool high;
+				{
+					std::lock_guard<std::mutex> lock(mtx_);
+					ctx->done_ = true;
+					doneCond_.notify_all();
+					high = lane != High && !lanes_[High].empty();
+				}
+				// high calls posted meanwhile go ahead of the rest of this batch
+				if (high)
+					runLane(High, -1);
+			}
+		}
+
+		static Application& instance()
+		{
+			static Application app;
+			return app;
+		}
+
+		static utils::TaskPool& pool()
+		{
+			static utils::TaskPool tasks([]()
+			{
+				Application& app = instance();
+				std::lock_guard<std::mutex> lock(app.mtx_);
+				app.woken_ = true;
+				app.cond_.notify_all();
+				wakeNative();
+			});
+			return tasks;
+		}
+
+		// the ui thread may be blocked in the gtk main loop rather than on cond_
+		static void wakeNative()
+		{
+#ifdef MINUI_GTK_DIRECT
+			if (gtk::lib().loaded())
+				gtk::lib().g_main_context_wakeup(nullptr);
+#endif
+		}
+
+#ifdef MINUI_GTK_DIRECT
+		// dispatch gtk events until one arrives, a wakeup or wait ms pass
+		void waitNative(int64_t wait)
+		{
+			gtk::Library& lib = gtk::lib();
+			{
+				std::lock_guard<std::mutex> lock(mtx_);
+				if (quit_ || woken_ || pending())
+					wait = 0;
+			}
+
+			if (wait <= 0)
+			{
+				while (lib.g_main_context_iteration(nullptr, false));
+				return;
+			}
+
+			// a wakeup between the check and the poll is kept by the context, the poll returns at once
+			bool fired = false;
+			int id = lib.g_timeout_add(int(wait), [](void* data) -> bool
+			{
+				*(bool*)data = true;
+				return gtk::SOURCE_REMOVE;
+			}, &fired);
+			lib.g_main_context_iteration(nullptr, true);
+			if (!fired)
+				lib.g_source_remove(id);
+		}
+#endif
+
+		Application() = default;
+
+		std::mutex mtx_;
+		std::condition_variable cond_;
+		std::condition_variable doneCond_;
+		std::deque<RunContext*> lanes_[LaneCount];
+		std::vector<Window*> windows_;
+		std::thread::id ui_;
+		int64_t clock_ = 0;
+		std::chrono::steady_clock::time_point last_; // real time the clock last moved to
+		bool woken_ = false;
+		std::atomic<bool> quit_{ false };
+		std::atomic<bool> dark_{ false };
+		OnThemeChangedFunc onThemeChanged_;
+	};
+
+	inline Window::~Window()
+	{
+		for (int i = 0; i < widgetIndex_; ++i)
+			widgets_[i]->setWindow(nullptr);
+
+#ifdef MINUI_GTK_DIRECT
+		if (handle_)
+			gtk::lib().gtk_window_destroy(handle_);
+#endif
+
+		auto& windows = Application::instance().windows_;
+		for (size_t i = 0; i < windows.size(); ++i)
+		{
+			if (windows[i] == this)
+			{
+				windows.erase(windows.begin() + i);
+				break;
+			}
+		}
+	}
+
+	inline bool Window::create()
+	{
+#ifdef MINUI_GTK_DIRECT
+		if (!createNative())
+			return false;
+#endif
+		Application::instance().windows_.push_back(this);
+		resize();
+		return true;
+	}
+
+	inline void Styles::setTheme(Theme* theme)
+	{
+		theme_.store(theme ? theme : &Theme::builtin(Application::isDarkMode()), std::memory_order_release);
+		for (auto window : Application::instance().windows_)
+			window->update();
+	}
+
+	inline bool Window::addTimer(int msec, const TimerFunc& fn)
+	{
+		if (timerIndex_ < TimerCount)
+		{
+			if (msec < 1)
+				msec = 1; // fireTimers steps due times by whole intervals
+			timers_[timerIndex_++] = Timer{ fn, msec, Application::now() + msec, true };
+			return true;
+		}
+		return false;
+	}
+
+	// large areas are split in tiles rasterized on the worker pool, the frame is done when all are
+	inline void Window::rasterize(const Rect& dirty)
+	{
+		Trace::Scope trace("rasterize");
+
+		int cols = (dirty.width + TileSize - 1) / TileSize;
+		int rows = (dirty.height + TileSize - 1) / TileSize;
+		if (dirty.width * dirty.height < ParallelArea || cols * rows == 1)
+		{
+			replay(dirty);
+			return;
+		}
+
+		Application::pool().parallelFor(cols * rows, [&](int i)
+		{
+			Trace::Scope trace("tile");
+			Rect tile = { dirty.x + (i % cols) * TileSize, dirty.y + (i / cols) * TileSize, TileSize, TileSize };
+			replay(tile.intersect(dirty));
+		});
+	}
+
+	// ticked by iterate() on the virtual clock
+	inline void Window::animate(const Widget* owner, const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat)
+	{
+		animator_.start(owner, key, msec, easing, fn, Application::now(), repeat);
+	}
+
+	class Label : public Widget
+	{
+	public:
+		Label()
+		{
+			setStyleName("label");
+		}
+
+		const char* text() const
+		{
+			return text_.c_str();
+		}
+
+		void setText(const char* text)
+		{
+			text_ = text;
+			update();
+		}
+
+	protected:
+		void draw(Painter& painter) override
+		{
+			if (text_.c_str())
+			{
+				auto style = Styles::instance().getStyle(styleName());
+				painter.drawText(rect(), text_, style);
+			}
+		}
+
+	private:
+		utils::String text_;
+	};
+
+
+	class Button : public Widget
+	{
+	public:
+		enum State
+		{
+			Normal,
+			Hover,
+			Press
+		};
+
+		enum { TransitionTime = 120 }; // ms
+
+		static const char* stateString(State state)
+		{
+			const char* strings[] = { "", ":hover", ":press" };
+			return strings[state];
+		}
+
+		using OnClickFunc = std::function<void()>;
+
+		Button()
+			: state_(Normal)
+		{
+			setStyleName("button");
+		}
+
+		// background cross-fade between states, 0 switches at once
+		void setTransition(int msec)
+		{
+			transition_ = msec;
+		}
+
+		State state() const
+		{
+			return state_;
+		}
+
+		const char* text() const
+		{
+			return text_.c_str();
+		}
+
+		void setText(const char* text)
+		{
+			text_ = text;
+			update();
+		}
+
+		void setOnClick(const OnClickFunc& fn)
+		{
+			onClick_ = fn;
+		}
+
+	protected:
+		void draw(Painter& painter) override
+		{
+			const char* name = painter.arena().concat(styleName(), stateString(state_));
+			auto style = Styles::instance().getStyle(name);
+			if (fade_ < 1)
+				style.backgroundColor = Animator::mix(from_, style.backgroundColor, fade_);
+
+			painter.withAA(rect(), [=](Painter& aaPainter)
+				{
+					aaPainter.fillRoundRect(rect(), style.radius, style.backgroundColor);
+				}
+			);
+
+			if (text_.c_str())
+				painter.drawText(rect(), text_, style); // text not need AA
+		}
+
+		// repaints come from setState() only, moving within the button costs nothing
+		void mouseMove(bool leave) override
+		{
+			setState(leave ? Normal : Hover);
+		}
+
+		void mouseButton(bool press) override
+		{
+			if (press)
+			{
+				setState(Press);
+			}
+			else
+			{
+				setState(Hover);
+				if (onClick_)
+					onClick_();
+			}
+		}
+
+	private:
+		// fade from the colour on screen, which may be mid-transition itself
+		void setState(State state)
+		{
+			if (state == state_)
+				return;
+
+			char name[128]; // no heap on the pointer path
+			snprintf(name, sizeof(name), "%s%s", styleName(), stateString(state_));
+			auto& style = Styles::instance().getStyle(name);
+			from_ = fade_ < 1 ? Animator::mix(from_, style.backgroundColor, fade_) : style.backgroundColor;
+			state_ = state;
+			fade_ = 0;
+			animate(&fade_, transition_, Animator::EaseOut, [=](float t)
+			{
+				fade_ = t;
+				update();
+			});
+		}
+
+		utils::String text_;
+		State state_;
+		OnClickFunc onClick_;
+		Color from_ = { 0 };
+		float fade_ = 1.0f;
+		int transition_ = TransitionTime;
+	};
+
+	class Progress : public Widget
+	{
+	public:
+		enum { PulsePeriod = 1600 }; // ms, there and back
+
+		Progress()
+			: step_(0)
+		{
+			setStyleName("progress");
+		}
+
+		// msec > 0 slides from the step shown now, leaves indeterminate mode
+		void setStep(float step, int msec = 0)
+		{
+			if (0 <= step && step <= 1.0)
+			{
+				setIndeterminate(false);
+				float from = step_;
+				animate(&step_, msec, Animator::EaseOut, [=](float t)
+				{
+					step_ = Animator::lerp(from, step, t);
+					update();
+				});
+			}
+		}
+
+		bool indeterminate() const
+		{
+			return indeterminate_;
+		}
+
+		// unknown amount of work: a block bounces along the bar on the frame clock, no calls needed
+		void setIndeterminate(bool v)
+		{
+			if (v == indeterminate_)
+				return;
+
+			indeterminate_ = v;
+			pulsing_ = false; // loop starts on the next paint, once the bar is in a window
+			if (!v)
+				animate(&pulse_, 0, Animator::Linear, [=](float) { pulse_ = 0; }); // replaces the loop
+			update();
+		}
+
+	protected:
+		void draw(Painter& painter) override
+		{
+			if (indeterminate_ && !pulsing_)
+			{
+				pulsing_ = true;
+				animate(&pulse_, PulsePeriod, Animator::Linear, [=](float t)
+				{
+					pulse_ = t;
+					update();
+				}, true);
+			}
+
+			auto style = Styles::instance().getStyle(styleName());
+			painter.withAA(rect(), [=](Painter& aaPainter)
+				{
+					aaPainter.fillRoundRect(rect(), style.radius, style.backgroundColor);
+					if (indeterminate_)
+					{
+						float pos = Animator::ease(Animator::EaseInOut, pulse_ < 0.5f ? pulse_ * 2 : 2 - pulse_ * 2);
+						Rect block = rect();
+						block.width /= 4;
+						block.x += int((rect().width - block.width) * pos);
+						aaPainter.fillRoundRect(block, style.radius, style.color);
+					}
+					else if (0 < step_)
+					{
+						Rect stepRect = rect();
+						stepRect.width *= step_;
+						aaPainter.fillRoundRect(stepRect, style.radius, style.color);
+					}
+				}
+			);
+		}
+
+	private:
+		float step_;
+		float pulse_ = 0; // phase of the bounce, 0 to 1
+		bool indeterminate_ = false;
+		bool pulsing_ = false;
+	};
+
+	class Image : public Widget
+	{
+	public:
+		Image()
+			: bmp_(nullptr)
+		{
+			setStyleName("image");
+		}
+
+		void setBmpData(const void* data, int size)
+		{
+			bmp_ = data;
+			size_ = size;
+			update();
+		}
+
+		// looked up in the active theme on paint, overrides setBmpData.
+		// Returns false, any number of images can follow the theme here.
+		bool setThemeImage(const char* name)
+		{
+			themeImage_ = name;
+			update();
+			return false;
+		}
+
+	protected:
+		void draw(Painter& painter) override
+		{
+			const void* bmp = bmp_;
+			int size = size_;
+			if (themeImage_)
+			{
+				auto image = Styles::instance().theme().findImage(themeImage_);
+				if (image)
+				{
+					bmp = image->data;
+					size = image->size;
+				}
+			}
+
+			if (bmp)
+			{
+				painter.withAA(rect(), [=](Painter& aaPainter)
+					{
+						aaPainter.drawImage(rect(), (const uint8_t*)bmp, size);
+					}
+				);
+			}
+		}
+
+	private:
+		const void* bmp_;
+		int size_;
+		const char* themeImage_ = nullptr;
+	};
+
+	class ListView : public Widget
+	{
+	public:
+		enum
+		{
+			ColumnCount = 4,
+			RowCount = 40, // max visible rows
+			TextLength = 128,
+			Padding = 6,
+			WheelDelta = 120
+		};
+
+		using DataFunc = std::function<void(int row, int column, char* text, int length)>;
+
+		ListView()
+			: count_(0)
+			, first_(0)
+			, rowHeight_(24)
+			, columns_(1)
+		{
+			setStyleName("listview");
+			for (int i = 0; i < ColumnCount; ++i)
+			{
+				widths_[i] = 0;
+				alignRight_[i] = false;
+			}
+			reload();
+		}
+
+		void setColumn(int column, int width, bool alignRight = false)
+		{
+			if (0 <= column && column < ColumnCount)
+			{
+				widths_[column] = width;
+				alignRight_[column] = alignRight;
+				if (column >= columns_)
+					columns_ = column + 1;
+				update();
+			}
+		}
+
+		void setRowHeight(int height)
+		{
+			if (height > 0)
+			{
+				rowHeight_ = height;
+				update();
+			}
+		}
 
-#include <string>
-#include <functional>
-#include <cstdint>
+		void setDataSource(int count, const DataFunc& fn)
+		{
+			data_ = fn;
+			count_ = count;
+			first_ = 0;
+			reload();
+		}
+
+		int count() const
+		{
+			return count_;
+		}
+
+		void setCount(int count)
+		{
+			count_ = count;
+			scrollTo(first_);
+		}
+
+		int scrollRow() const
+		{
+			return first_;
+		}
+
+		void scrollTo(int row)
+		{
+			int last = count_ - pageRows();
+			if (row > last)
+				row = last;
+			if (row < 0)
+				row = 0;
+
+			if (row != first_)
+			{
+				first_ = row;
+				update();
+			}
+		}
+
+		// drop all bound rows, next paint fetches visible rows again
+		void reload()
+		{
+			for (auto& row : rows_)
+				row.index = -1;
+			update();
+		}
+
+	protected:
+		void draw(Painter& painter) override
+		{
+			auto& style = Styles::instance().getStyle(styleName());
+			painter.fillRect(rect(), style.backgroundColor);
+
+			int visible = visibleRows();
+			for (int i = 0; i < visible; ++i)
+			{
+				const Row& row = bindRow(first_ + i);
+				Rect cell = { rect().x, rect().y + i * rowHeight_, 0, rowHeight_ };
+				for (int c = 0; c < columns_; ++c)
+				{
+					cell.width = columnWidth(c);
+					Rect textRect = { cell.x + Padding, cell.y, cell.width - Padding * 2, cell.height };
+					painter.drawText(textRect, row.text[c], style, alignRight_[c] ? Painter::AlignRight : Painter::AlignLeft);
+					cell.x += cell.width;
+				}
+			}
+		}
+
+		void mouseWheel(int delta) override
+		{
+			scrollTo(first_ - delta / WheelDelta * 3);
+		}
+
+	private:
+		struct Row
+		{
+			int index;
+			char text[ColumnCount][TextLength];
+		};
+
+		// rows that fit the height, independent of the scroll position
+		int pageRows() const
+		{
+			int rows = rect().height / rowHeight_;
+			return rows > RowCount ? RowCount : rows;
+		}
+
+		int visibleRows() const
+		{
+			int rows = pageRows();
+			if (rows > count_ - first_)
+				rows = count_ - first_;
+			return rows > 0 ? rows : 0;
+		}
+
+		int columnWidth(int column) const
+		{
+			if (widths_[column] > 0)
+				return widths_[column];
+
+			// unsized column takes the rest
+			int width = rect().width;
+			for (int i = 0; i < columns_; ++i)
+				width -= widths_[i];
+			return width > 0 ? width : 0;
+		}
+
+		// rows recycle by slot, scrolling only fetches rows which are new in view
+		const Row& bindRow(int index)
+		{
+			Row& row = rows_[index % RowCount];
+			if (row.index != index)
+			{
+				row.index = index;
+				for (int c = 0; c < columns_; ++c)
+				{
+					row.text[c][0] = 0;
+					if (data_)
+						data_(index, c, row.text[c], TextLength);
+					row.text[c][TextLength - 1] = 0;
+				}
+			}
+			return row;
+		}
+
+	private:
+		DataFunc data_;
+		int count_;
+		int first_;
+		int rowHeight_;
+		int columns_;
+		int widths_[ColumnCount];
+		bool alignRight_[ColumnCount];
+		Row rows_[RowCount];
+	};
+
+	inline void Window::show()
+	{
+		shown_ = true;
+		update();
+#ifdef MINUI_GTK_DIRECT
+		if (handle_)
+			gtk::lib().gtk_window_present(handle_);
+#endif
+
+		close_ = new Button();
+		close_->setStyleName("CloseButton");
+		close_->setRect(Rect{ rect_.width - 48, 0,  48, 32 });
+		close_->setOnDraw([=](Painter& painter)
+			{
+				Rect rect = close_->rect();
+				painter.withAA(rect, [=](Painter& aaPainter)
+					{
+						const char* name = aaPainter.arena().concat("CloseButton", Button::stateString(close_->state()));
+						auto& style = Styles::instance().getStyle(name);
+						// draw 12 x 12  x
+						int xCenter = rect.x + rect.width / 2;
+						int yCenter = rect.y + rect.height / 2;
+						aaPainter.drawLine(xCenter, yCenter, xCenter - 6, yCenter + 6, 1, style.color);
+						aaPainter.drawLine(xCenter, yCenter, xCenter + 6, yCenter + 6, 1, style.color);
+						aaPainter.drawLine(xCenter, yCenter, xCenter + 6, yCenter - 6, 1, style.color);
+						aaPainter.drawLine(xCenter, yCenter, xCenter - 6, yCenter - 6, 1, style.color);
+					}
+				);
+			});
+		close_->setOnClick([=]
+			{
+				this->close();
+				Application::quit();
+			});
+
+		addWidget(close_);
+	}
+
+	inline void Window::setCloseable(bool v)
+	{
+		close_->setVisible(v);
+	}
+
+#ifdef MINUI_GTK_DIRECT
+	// whole notches only, smooth scrolling collects fractions
+	inline void Window::onNativeScroll(double dy)
+	{
+		wheel_ -= dy * ListView::WheelDelta;
+		int notches = int(wheel_ / ListView::WheelDelta);
+		if (notches)
+		{
+			wheel_ -= notches * ListView::WheelDelta;
+			injectMouseWheel(notches * ListView::WheelDelta);
+		}
+	}
+#endif
+}
+
+#endif
+
+#if defined(WIN32) && !defined(MINUI_SOFTWARE)
+
+#define MINUI_FONT_SIZE 18
+#define MINUI_FONT_FAMILY "Microsoft YaHei UI", "SimSun", "sans-seirf", "sans", "Ariel", NULL
+#define MINUI_FONT_CSS "Microsoft YaHei UI,SimSun,sans-seirf,sans,Ariel,"
 
 namespace minui
 {
@@ -44,6 +4703,94 @@ namespace minui
 		{
 			return MulDiv(origin, dpi, 96);
 		}
+
+		// Memory DCs with a bitmap selected, kept across frames and handed out by size.
+		// trim() after a frame frees the ones that frame did not use.
+		class ScratchPool
+		{
+		public:
+			ScratchPool() = default;
+			ScratchPool(const ScratchPool&) = delete;
+			ScratchPool& operator=(const ScratchPool&) = delete;
+
+			~ScratchPool()
+			{
+				for (auto& s : surfaces_)
+					destroy(s);
+			}
+
+			// contents are undefined
+			HDC acquire(HDC hdc, int width, int height)
+			{
+				for (auto& s : surfaces_)
+				{
+					if (!s.busy && s.width == width && s.height == height)
+					{
+						s.busy = true;
+						s.used = true;
+						return s.dc;
+					}
+				}
+
+				Surface s = { CreateCompatibleDC(hdc), CreateCompatibleBitmap(hdc, width, height), NULL, width, height, true, true };
+				s.old = (HBITMAP)SelectObject(s.dc, s.bitmap);
+				FrameArena::countAllocation();
+				surfaces_.push_back(s);
+				return s.dc;
+			}
+
+			void release(HDC dc)
+			{
+				SelectClipRgn(dc, NULL);
+				for (auto& s : surfaces_)
+				{
+					if (s.dc == dc)
+					{
+						s.busy = false;
+						return;
+					}
+				}
+			}
+
+			void trim()
+			{
+				size_t kept = 0;
+				for (auto& s : surfaces_)
+				{
+					if (s.used || s.busy)
+					{
+						s.used = false;
+						surfaces_[kept++] = s;
+					}
+					else
+					{
+						destroy(s);
+					}
+				}
+				surfaces_.resize(kept);
+			}
+
+		private:
+			struct Surface
+			{
+				HDC dc;
+				HBITMAP bitmap;
+				HBITMAP old;
+				int width;
+				int height;
+				bool busy;
+				bool used; // since the last trim()
+			};
+
+			static void destroy(Surface& s)
+			{
+				SelectObject(s.dc, s.old);
+				DeleteObject(s.bitmap);
+				DeleteDC(s.dc);
+			}
+
+			std::vector<Surface> surfaces_;
+		};
 	}
 
 	class Handle
@@ -114,16 +4861,29 @@ namespace minui
 
 	struct Style
 	{
+		enum { FontFamilyCount = 6 };
+
+		// fields a derived style overrides, see Theme::setStyle
+		enum Field
+		{
+			ColorField = 1 << 0,
+			BackgroundColorField = 1 << 1,
+			RadiusField = 1 << 2,
+			FontSizeField = 1 << 3,
+			FontFamilyField = 1 << 4,
+			AllFields = (1 << 5) - 1
+		};
+
 		const char* name;
 		Color color;
 		Color backgroundColor;
 		int radius;
 		int fontSize;
-		const char* fontFamily[6];
+		const char* fontFamily[FontFamilyCount];
 
 		static const Style& defaultStyle(bool isDark = false)
 		{
-			static Style styles[2] =
+			static constexpr Style styles[2] =
 			{
 				// light
 				{
@@ -131,8 +4891,8 @@ namespace minui
 					Color{50, 50, 50},
 					Color{250, 250, 251},
 					6,
-					18,
-					{"Microsoft YaHei UI", "SimSun", "sans-seirf", "sans", "Ariel", NULL}
+					MINUI_FONT_SIZE,
+					{ MINUI_FONT_FAMILY }
 				},
 				// dark
 				{
@@ -140,47 +4900,72 @@ namespace minui
 					Color{250, 250, 250},
 					Color{ 34,34,38 },
 					6,
-					18,
-					{"Microsoft YaHei UI", "SimSun", "sans-seirf", "sans", "Ariel", NULL}
+					MINUI_FONT_SIZE,
+					{ MINUI_FONT_FAMILY }
 				}
 			};
 			return styles[isDark];
 		}
 	};
 
-	class Styles : public Handle
+	// Built-in light and dark styles, read-only tables resolved at compile time.
+	template <typename T = void>
+	struct DefaultStyles
 	{
-	public:
-		enum { MaxCount = 32 };
+		static constexpr Style light[] = { MINUI_STYLES_LIGHT(MINUI_STYLE) };
+		static constexpr Style dark[] = { MINUI_STYLES_DARK(MINUI_STYLE) };
 
-		static Styles& instance()
+		// not used by Direct-UI, kept for the same Theme declarations on every platform
+		static constexpr const char lightCss[] = MINUI_STYLES_LIGHT(MINUI_STYLE_CSS);
+		static constexpr const char darkCss[] = MINUI_STYLES_DARK(MINUI_STYLE_CSS);
+	};
+
+	template <typename T> constexpr Style DefaultStyles<T>::light[];
+	template <typename T> constexpr Style DefaultStyles<T>::dark[];
+	template <typename T> constexpr const char DefaultStyles<T>::lightCss[];
+	template <typename T> constexpr const char DefaultStyles<T>::darkCss[];
+
+	// A named bundle of styles and themed images, prepared once per theme.
+	// Styles::setTheme() switches bundles by swapping a pointer.
+	class Theme : public Handle, public utils::ThemeBase<Style>
+	{
+	public:
+		explicit Theme(const char* name = nullptr)
+			: ThemeBase(name)
 		{
-			static Styles styles;
-			return styles;
 		}
 
-		bool setStyle(const char* name, Style style)
+		// read-only styles, usually a constexpr table, setStyle() overrides them.
+		// css is the table's pre-rendered text, used by gtk only.
+		template <size_t N>
+		Theme(const char* name, const Style (&table)[N], const char* css = nullptr)
+			: ThemeBase(name, table, int(N))
 		{
-			style.name = name;
-			int index = findStyle(name);
-
-			if (index == -1)
-				return addStyle(style);
-
-			styles_[index] = style;
-			return true;
-
 		}
 
-		const Style& getStyle(const char* name) const
+		static Theme& builtin(bool darkMode)
 		{
-			int index = findStyle(name);
-			if (index != -1)
-				return styles_[index];
+			static Theme light("light", DefaultStyles<>::light);
+			static Theme dark("dark", DefaultStyles<>::dark);
+			return darkMode ? dark : light;
+		}
+
+		// styles are read on paint, nothing to render ahead
+		void prepare() {}
+	};
 
-			return Style::defaultStyle();
+	class Styles : public Handle, public utils::StylesBase<Theme, Style>
+	{
+	public:
+		static Styles& instance()
+		{
+			static Styles styles;
+			return styles;
 		}
 
+		// nullptr goes back to the built-in theme, windows repaint once
+		void setTheme(Theme* theme);
+
 		void update() {}
 
 	private:
@@ -189,31 +4974,12 @@ namespace minui
 
 		}
 
-		int findStyle(const char* name) const
+		// the top level windows of the ui thread
+		static BOOL CALLBACK invalidateWindow(HWND hwnd, LPARAM)
 		{
-			for (int i = 0; i < MaxCount; ++i)
-			{
-
-				const Style& style = styles_[i];
-				if (!style.name)
-					return -1;
-
-				if (strcmp(style.name, name) == 0)
-					return i;
-			}
-			return -1;
-		}
-
-		bool addStyle(Style style)
-		{
-			if (index_ < MaxCount)
-				styles_[index_++] = style;
-			return index_ <= MaxCount;
+			InvalidateRect(hwnd, NULL, FALSE);
+			return TRUE;
 		}
-
-	private:
-		Style styles_[MaxCount] = { 0 };
-		int index_ = 0;
 	};
 
 	class Painter : public Handle
@@ -222,10 +4988,25 @@ namespace minui
 		template <typename F> // F=void(Painter&)
 		void withAA(const Rect& rect, const F& fn) const
 		{
-			Painter painter(mdc_, rect, scale_, 4);
+			Painter painter(mdc_, rect, scale_, 4, *pool_, *arena_);
+			fn(painter);
+		}
+
+		// F=void(Painter&), alpha blended back instead of copied
+		template <typename F>
+		void withOpacity(const Rect& rect, float opacity, const F& fn) const
+		{
+			Painter painter(mdc_, rect, scale_, scale_, *pool_, *arena_);
+			painter.alpha_ = BYTE(opacity * 255 + 0.5f);
 			fn(painter);
 		}
 
+		// scratch memory for this frame, e.g. style names
+		utils::FrameArena& arena() const
+		{
+			return *arena_;
+		}
+
 		void drawLine(int x, int y, int x1, int y1, int lineWidth, Color color)
 		{
 			HPEN pen = CreatePen(PS_SOLID, transform(lineWidth), color.toColorRef());
@@ -240,7 +5021,41 @@ namespace minui
 			DeleteObject(pen);
 		}
 
-		void drawText(const Rect& rect, const char* text, const Style& style)
+		enum TextAlign
+		{
+			AlignCenter = DT_CENTER,
+			AlignLeft = DT_LEFT,
+			AlignRight = DT_RIGHT
+		};
+
+		void drawText(const Rect& rect, const utils::String& text, const Style& style, TextAlign align = AlignCenter)
+		{
+			drawText(rect, text.wstr(), int(text.wlength()), style, align); // cached UTF-16, no conversion
+		}
+
+		void drawText(const Rect& rect, const char* text, const Style& style, TextAlign align = AlignCenter)
+		{
+			wchar_t buf[256];
+			int length = MultiByteToWideChar(CP_UTF8, 0, text, -1, buf, 256);
+			if (length > 0)
+			{
+				drawText(rect, buf, length - 1, style, align);
+				return;
+			}
+
+			// longer than stack buffer
+			length = MultiByteToWideChar(CP_UTF8, 0, text, -1, NULL, 0);
+			if (length <= 0)
+				return;
+
+			auto mark = arena_->mark();
+			wchar_t* str = arena_->allocate<wchar_t>(length);
+			MultiByteToWideChar(CP_UTF8, 0, text, -1, str, length);
+			drawText(rect, str, length - 1, style, align);
+			arena_->rewind(mark);
+		}
+
+		void drawText(const Rect& rect, const wchar_t* text, int length, const Style& style, TextAlign align = AlignCenter)
 		{
 			HFONT oldFont;
 			HFONT font = createFont(style);
@@ -248,10 +5063,9 @@ namespace minui
 				oldFont = (HFONT)SelectObject(mdc_, font);
 
 			SetBkMode(mdc_, TRANSPARENT);
-			auto str = utils::utf8ToUtf16(text);
 			auto drawRect = rect.scale(scale_).toRect();
 			auto oldColor = SetTextColor(mdc_, style.color.toColorRef());
-			DrawText(mdc_, str.data, str.length, &drawRect, DT_CENTER | DT_SINGLELINE | DT_VCENTER);
+			DrawText(mdc_, text, length, &drawRect, align | DT_SINGLELINE | DT_VCENTER | DT_END_ELLIPSIS);
 			SetTextColor(mdc_, oldColor);
 
 			if (font)
@@ -263,6 +5077,9 @@ namespace minui
 
 		void drawImage(const Rect& rect, const uint8_t* bmp, int size)
 		{
+			Metrics::Scope scope(Metrics::ImageDecode);
+			Trace::Scope trace("image_decode");
+
 			if (bmp[0] != 0x42 && bmp[1] != 0x4d)
 				return;
 
@@ -336,13 +5153,15 @@ namespace minui
 	private:
 		friend class Window;
 
-		Painter(HDC hdc, const Rect& rect, float scale, float ss)
+		Painter(HDC hdc, const Rect& rect, float scale, float ss, utils::ScratchPool& pool, utils::FrameArena& arena)
 			: hdc_(hdc)
 			, rect_(rect)
 			, sRect_(rect.scale(scale))
 			, ssRect_(rect.scale(ss))
 			, scale_(scale)
 			, ss_(ss)
+			, pool_(&pool)
+			, arena_(&arena)
 		{
 			if (scale_ > ss_)
 			{
@@ -352,9 +5171,7 @@ namespace minui
 			ssRect_.x = 0;
 			ssRect_.y = 0;
 
-			mdc_ = CreateCompatibleDC(hdc);
-			bitmap_ = CreateCompatibleBitmap(hdc, ssRect_.width, ssRect_.height);
-			old_ = (HBITMAP)SelectObject(mdc_, bitmap_);
+			mdc_ = pool_->acquire(hdc, ssRect_.width, ssRect_.height);
 			SetStretchBltMode(mdc_, HALFTONE);
 			SetBrushOrgEx(mdc_, 0, 0, NULL);
 			StretchBlt(mdc_, ssRect_.x, ssRect_.y, ssRect_.width, ssRect_.height, hdc_, sRect_.x, sRect_.y, sRect_.width, sRect_.height, SRCCOPY);
@@ -362,12 +5179,18 @@ namespace minui
 
 		~Painter()
 		{
-			SetStretchBltMode(hdc_, HALFTONE);
-			SetBrushOrgEx(hdc_, 0, 0, NULL);
-			StretchBlt(hdc_, sRect_.x, sRect_.y, sRect_.width, sRect_.height, mdc_, 0, 0, ssRect_.width, ssRect_.height, SRCCOPY);
-			SelectObject(mdc_, old_);
-			DeleteObject(bitmap_);
-			DeleteDC(mdc_);
+			if (alpha_ < 255)
+			{
+				BLENDFUNCTION blend = { AC_SRC_OVER, 0, alpha_, 0 };
+				GdiAlphaBlend(hdc_, sRect_.x, sRect_.y, sRect_.width, sRect_.height, mdc_, 0, 0, ssRect_.width, ssRect_.height, blend);
+			}
+			else
+			{
+				SetStretchBltMode(hdc_, HALFTONE);
+				SetBrushOrgEx(hdc_, 0, 0, NULL);
+				StretchBlt(hdc_, sRect_.x, sRect_.y, sRect_.width, sRect_.height, mdc_, 0, 0, ssRect_.width, ssRect_.height, SRCCOPY);
+			}
+			pool_->release(mdc_);
 		}
 
 		void setClipRect(const Rect& rect)
@@ -416,14 +5239,15 @@ namespace minui
 
 	private:
 		HDC hdc_;
-		HDC mdc_;
-		HBITMAP bitmap_;
-		HBITMAP old_;
+		HDC mdc_; // from pool_
 		Rect rect_;
 		Rect sRect_; // scale rect
 		Rect ssRect_; // super sample rect
 		float scale_;
 		float ss_; // super sample sacle
+		BYTE alpha_ = 255;
+		utils::ScratchPool* pool_;
+		utils::FrameArena* arena_;
 	};
 
 	class Window;
@@ -433,7 +5257,7 @@ namespace minui
 	public:
 		using OnDrawFunc = std::function<void(Painter&)>;
 
-		virtual ~Widget() = default;
+		virtual ~Widget();
 
 		const char* styleName() const
 		{
@@ -453,6 +5277,7 @@ namespace minui
 		void setRect(const Rect& rect)
 		{
 			rect_ = rect;
+			layoutChanged();
 		}
 
 		bool visible() const
@@ -463,16 +5288,29 @@ namespace minui
 		void setVisible(bool v)
 		{
 			visible_ = v;
+			layoutChanged();
+		}
+
+		float opacity() const
+		{
+			return opacity_;
 		}
 
+		// 0 is transparent and not painted, msec > 0 fades from the current opacity
+		void setOpacity(float opacity, int msec = 0);
+
 		void update();
 
 	protected:
 		Widget() = default;
 
+		// fn runs on every frame until msec elapsed, starting the same key again replaces it
+		void animate(const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat = false);
+
 		virtual void draw(Painter& painter) {}
 		virtual void mouseMove(bool leave) {}
 		virtual void mouseButton(bool press) {}
+		virtual void mouseWheel(int delta) {}
 
 	private:
 		friend class Window;
@@ -481,6 +5319,8 @@ namespace minui
 			window_ = win;
 		}
 
+		void layoutChanged();
+
 		void setOnDraw(const OnDrawFunc& fn)
 		{
 			onDraw_ = fn;
@@ -501,6 +5341,7 @@ namespace minui
 		const char* name_ = nullptr;
 		Window* window_ = nullptr;
 		OnDrawFunc onDraw_;
+		float opacity_ = 1.0f;
 		bool visible_ = true;
 	};
 
@@ -512,7 +5353,9 @@ namespace minui
 		enum
 		{
 			TimerCount = 32,
-			WidgetCount = 64
+			WidgetCount = 256,
+			AnimationTimer = TimerCount, // timer id, set only while animating
+			PointerTimer // timer id, delivers a coalesced mouse move
 		};
 
 		using TimerFunc = std::function<bool()>;
@@ -520,7 +5363,6 @@ namespace minui
 
 		Window()
 			: hwnd_(NULL)
-			, title_(nullptr)
 			, rect_{ 0 }
 			, close_(nullptr)
 			, timerId_(0)
@@ -529,12 +5371,16 @@ namespace minui
 			, scale_(1.0)
 			, mouseWidget_(nullptr)
 			, mouseIn_(false)
+			, animating_(false)
 		{
 
 		}
 
 		~Window()
 		{
+			for (int i = 0; i < widgetIndex_; ++i)
+				widgets_[i]->setWindow(nullptr);
+
 			if (hwnd_)
 				DestroyWindow(hwnd_);
 		}
@@ -543,19 +5389,19 @@ namespace minui
 
 		const char* title() const
 		{
-			return title_;
+			return title_.c_str();
 		}
 
 		void setTitle(const char* text)
 		{
 			title_ = text;
-			auto titleText = utils::utf8ToUtf16(text);
-			SetWindowText(hwnd_, titleText.data);
+			SetWindowText(hwnd_, title_.wstr());
 		}
 
 		void setSize(int width, int height)
 		{
 			rect_ = Rect{ 0, 0, width, height };
+			layoutDirty_ = true;
 			SetWindowPos(hwnd_, NULL, 0, 0, utils::dpiScale(width, dpi_), utils::dpiScale(height, dpi_), SWP_NOMOVE | SWP_NOZORDER | SWP_FRAMECHANGED);
 		}
 
@@ -565,6 +5411,7 @@ namespace minui
 			{
 				widgets_[widgetIndex_++] = w;
 				w->setWindow(this);
+				layoutDirty_ = true;
 				return true;
 			}
 			return false;
@@ -603,6 +5450,7 @@ namespace minui
 
 	private:
 		friend class Application;
+		friend class Widget;
 
 		static constexpr LPCTSTR WndClass = L"minuiWindow";
 
@@ -617,6 +5465,10 @@ namespace minui
 			case WM_ERASEBKGND:
 				return 0;
 
+			case WM_SIZE:
+				window->layoutDirty_ = true; // hit grid covers the client area
+				break;
+
 			case WM_NCCALCSIZE:
 				return 0;
 
@@ -626,7 +5478,7 @@ namespace minui
 				ScreenToClient(hwnd, &pt);
 
 				Point point = { pt.x, pt.y };
-				window->onMouseMove(point, false);
+				window->onPointer(point);
 
 				if (window->onTestTitle(point))
 					return HTCAPTION;
@@ -636,7 +5488,11 @@ namespace minui
 
 			case WM_TIMER:
 			{
-				if (window->onTimer(wParam))
+				if (wParam == AnimationTimer)
+					window->onAnimate();
+				else if (wParam == PointerTimer)
+					window->flushPointer();
+				else if (window->onTimer(wParam))
 					KillTimer(hwnd, wParam);
 				break;
 			}
@@ -655,9 +5511,13 @@ namespace minui
 				return 0;
 			}
 
-			case WM_MOUSELEAVE:
 			case WM_MOUSEMOVE:
-				window->onMouseMove(Point{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) }, msg == WM_MOUSELEAVE);
+				window->onPointer(Point{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) });
+				return 0;
+
+			case WM_MOUSELEAVE:
+				window->dropPointer();
+				window->onMouseMove(Point{ 0, 0 }, true);
 				return 0;
 			
 			case WM_LBUTTONDOWN:
@@ -665,6 +5525,14 @@ namespace minui
 				window->onMouseButton(msg == WM_LBUTTONDOWN);
 				return 0;
 
+			case WM_MOUSEWHEEL:
+				window->onMouseWheel(GET_WHEEL_DELTA_WPARAM(wParam));
+				return 0;
+
+			case WM_SETTINGCHANGE:
+				window->onSettingChange((LPCWSTR)lParam);
+				break;
+
 			case 0x02E0: // WM_DPICHANGED
 			{
 				window->onDpiChanged(HIWORD(wParam));
@@ -693,31 +5561,104 @@ namespace minui
 				onClose_();
 		}
 
+		void onSettingChange(LPCWSTR area);
+
 		bool onTimer(int id)
 		{
+			Metrics::Scope scope(Metrics::Timer);
+			Trace::Scope trace("timer");
 			return timers_[id]();
 		}
+
+		// the widget is going away, drop it with its tweens
+		void detach(Widget* w)
+		{
+			animator_.stop(w);
+			if (mouseWidget_ == w)
+				mouseWidget_ = nullptr;
+			for (int i = 0; i < widgetIndex_; ++i)
+			{
+				if (widgets_[i] == w)
+				{
+					memmove(&widgets_[i], &widgets_[i + 1], (widgetIndex_ - i - 1) * sizeof(Widget*));
+					widgetIndex_--;
+					layoutDirty_ = true;
+					break;
+				}
+			}
+		}
+
+		void animate(const Widget* owner, const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat)
+		{
+			animator_.start(owner, key, msec, easing, fn, GetTickCount64(), repeat);
+			if (animator_.active() && !animating_)
+				animating_ = ::SetTimer(hwnd_, AnimationTimer, Animator::FrameInterval, NULL) != 0;
+		}
+
+		// all tweens of the window advance together, the timer goes away when they are done
+		void onAnimate()
+		{
+			if (!animator_.tick(GetTickCount64()))
+			{
+				KillTimer(hwnd_, AnimationTimer);
+				animating_ = false;
+			}
+		}
 		
 		void onDpiChanged(int dpi)
 		{
 			dpi_ = dpi;
 			scale_ = float(dpi) / 96.0;
+			layoutDirty_ = true;
+		}
+
+		// topmost visible widget under the client point, -1 if none
+		int hitTest(Point pt)
+		{
+			if (layoutDirty_)
+			{
+				layoutDirty_ = false;
+				RECT client = { 0 };
+				GetClientRect(hwnd_, &client);
+				grid_.reset(client.right - client.left, client.bottom - client.top);
+				for (int i = 0; i < widgetIndex_; ++i)
+				{
+					Widget* widget = widgets_[i];
+					Rect rect = widget->visible() ? widget->rect().scale(scale_) : Rect{ 0 };
+					grid_.add(rect.x, rect.y, rect.width, rect.height);
+				}
+				grid_.build();
+			}
+			return grid_.find(pt.x, pt.y);
 		}
 
 		void onPaint(HDC hdc, int width, int height)
 		{
+			Metrics::Scope scope(Metrics::Paint);
+			Trace::Scope trace("paint");
+
 			auto rect = Rect{ 0,0,width, height }.scale(1.0 / scale_);
 			auto style = Styles::instance().getStyle("window");
 
-			Painter painter(hdc, rect, scale_, scale_);
-			painter.fillRect(rect, style.backgroundColor);
-
-			for (int i = 0; i < widgetIndex_; ++i)
+			arena_.reset();
 			{
-				Widget* widget = widgets_[i];
-				painter.setClipRect(widget->rect());
-				widget->onDraw(painter);
+				Painter painter(hdc, rect, scale_, scale_, scratch_, arena_);
+				painter.fillRect(rect, style.backgroundColor);
+
+				for (int i = 0; i < widgetIndex_; ++i)
+				{
+					Widget* widget = widgets_[i];
+					if (widget->opacity_ <= 0)
+						continue;
+
+					painter.setClipRect(widget->rect());
+					if (widget->opacity_ < 1)
+						painter.withOpacity(widget->rect(), widget->opacity_, [=](Painter& p) { widget->onDraw(p); });
+					else
+						widget->onDraw(painter);
+				}
 			}
+			scratch_.trim();
 		}
 
 		void onMouseMove(Point pt, bool leave)
@@ -733,17 +5674,15 @@ namespace minui
 			if (!mouseIn_)
 				mouseIn_ = trackMouseEvent(hwnd_);
 
-			for (int i = widgetIndex_ - 1; i >= 0; --i)
+			int hit = hitTest(pt);
+			if (hit >= 0)
 			{
-				Widget* widget = widgets_[i];
-				if (widget->visible() && widget->rect().scale(scale_).contains(pt))
-				{
-					if (mouseWidget_ && widget != mouseWidget_)
-						mouseWidget_->mouseMove(true); // mouse leave
-					widget->mouseMove(false);
-					mouseWidget_ = widget;
-					return;
-				}
+				Widget* widget = widgets_[hit];
+				if (mouseWidget_ && widget != mouseWidget_)
+					mouseWidget_->mouseMove(true); // mouse leave
+				widget->mouseMove(false);
+				mouseWidget_ = widget;
+				return;
 			}
 
 			if (mouseWidget_)
@@ -753,19 +5692,65 @@ namespace minui
 			}
 		}
 
+		// at most one hover update per frame, the last position wins
+		void onPointer(Point pt)
+		{
+			pointer_ = pt;
+			if (movePending_)
+				return;
+
+			ULONGLONG now = GetTickCount64();
+			if (now - lastMove_ >= Animator::FrameInterval)
+			{
+				lastMove_ = now;
+				onMouseMove(pt, false);
+			}
+			else
+			{
+				movePending_ = true;
+				::SetTimer(hwnd_, PointerTimer, UINT(Animator::FrameInterval - (now - lastMove_)), NULL);
+			}
+		}
+
+		void flushPointer()
+		{
+			if (movePending_)
+			{
+				dropPointer();
+				lastMove_ = GetTickCount64();
+				onMouseMove(pointer_, false);
+			}
+		}
+
+		void dropPointer()
+		{
+			if (movePending_)
+			{
+				KillTimer(hwnd_, PointerTimer);
+				movePending_ = false;
+			}
+		}
+
 		void onMouseButton(bool press)
 		{
+			flushPointer();
 			if (mouseWidget_)
 				mouseWidget_->mouseButton(press);
 		}
 
+		void onMouseWheel(int delta)
+		{
+			if (mouseWidget_)
+				mouseWidget_->mouseWheel(delta);
+		}
+
 		bool onTestTitle(Point pt)
 		{
 			return titleRect_.scale(scale_).contains(pt);
 		}
 
 		HWND hwnd_;
-		const char* title_;
+		utils::String title_;
 		Rect rect_;
 		Rect titleRect_;
 		Button* close_;
@@ -778,20 +5763,66 @@ namespace minui
 		Widget* widgets_[WidgetCount];
 		Widget* mouseWidget_;
 		bool mouseIn_;
-
+		bool animating_;
+		bool layoutDirty_ = true;
+		bool movePending_ = false;
+		Point pointer_ = { 0, 0 };
+		ULONGLONG lastMove_ = 0;
+		Animator animator_;
+		utils::HitGrid grid_; // widgets in device pixels
+		utils::ScratchPool scratch_; // supersample and opacity buffers
+		utils::FrameArena arena_; // paint temporaries, reset every frame
 	};
 
+	inline Widget::~Widget()
+	{
+		if (window_)
+			window_->detach(this);
+	}
+
+	inline void Widget::layoutChanged()
+	{
+		if (window_)
+			window_->layoutDirty_ = true;
+	}
+
 	inline void Widget::update()
 	{
 		if (window_ && visible_)
 			window_->update();
 	}
 
+	inline void Widget::animate(const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat)
+	{
+		if (window_)
+			window_->animate(this, key, msec, easing, fn, repeat);
+		else
+			fn(1);
+	}
+
+	inline void Widget::setOpacity(float opacity, int msec)
+	{
+		float from = opacity_;
+		animate(&opacity_, msec, Animator::EaseOut, [=](float t)
+		{
+			opacity_ = Animator::lerp(from, opacity, t);
+			update();
+		});
+	}
+
 	class Application : public Handle
 	{
 	public:
-		static bool initialize(const char* appId)
+		// both mean the same here, windows and their messages belong to the thread calling initialize()
+		enum Loop
 		{
+			OwnThread,
+			HostThread
+		};
+
+		static bool initialize(const char* appId, Loop loop = OwnThread)
+		{
+			Trace::setThreadName("minui-ui");
 			initDpiAwareness();
 
 			WNDCLASSEX wcx = { 0 };
@@ -808,6 +5839,14 @@ namespace minui
 			if (atom == 0)
 				return false;
 
+			// message-only window, wakes the ui thread for task continuations
+			HWND hwnd = CreateWindowEx(0, Window::WndClass, L"", 0, 0, 0, 0, 0, HWND_MESSAGE, NULL, NULL, NULL);
+			if (!hwnd)
+				return false;
+			SetWindowLongPtr(hwnd, GWLP_WNDPROC, (LONG_PTR)MessageProc);
+			messageWindow() = hwnd;
+
+			theme().dark_ = queryDarkMode();
 			setStyles(isDarkMode());
 			return true;
 		}
@@ -827,60 +5866,98 @@ namespace minui
 			PostQuitMessage(0);
 		}
 
-		static void setStyles(bool darkMode)
+		// wait up to timeout ms (-1 without limit) for a message, then dispatch all that are queued.
+		// Returns false once WM_QUIT arrives.
+		static bool pump(int timeout)
 		{
-			Styles& styles = Styles::instance();
-			auto style = Style::defaultStyle(darkMode);
+			MsgWaitForMultipleObjectsEx(0, NULL, timeout < 0 ? INFINITE : DWORD(timeout), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+			iterate();
 
-			styles.setStyle("window", style);
-			styles.setStyle("label", style);
-			styles.setStyle("image", style);
+			bool quitting = quitReceived();
+			quitReceived() = false;
+			return !quitting;
+		}
 
-			if (!darkMode)
+		// dispatch queued messages without blocking, returns whether there were any
+		static bool iterate()
+		{
+			bool any = false;
+			MSG msg;
+			while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
 			{
-				// light
-				style.backgroundColor = Color{ 230, 230, 230 };
-				styles.setStyle("button", style);
+				any = true;
+				if (msg.message == WM_QUIT)
+				{
+					quitReceived() = true;
+					break;
+				}
+				::TranslateMessage(&msg);
+				::DispatchMessage(&msg);
+			}
+			return any;
+		}
 
-				style.backgroundColor = Color{ 220,220,221 };
-				styles.setStyle("button:hover", style);
+		// switch to the built-in light or dark theme
+		static void setStyles(bool darkMode)
+		{
+			Styles::instance().setTheme(&Theme::builtin(darkMode));
+		}
 
-				style.backgroundColor = Color{ 190,190,192 };
-				styles.setStyle("button:press", style);
+		// fill a theme bundle with the built-in styles
+		static void setStyles(Theme& theme, bool darkMode)
+		{
+			const auto& table = darkMode ? DefaultStyles<>::dark : DefaultStyles<>::light;
+			for (const Style& style : table)
+				theme.setStyle(style.name, style);
+		}
 
-				style.color = Color{ 53,132,228 };
-				style.backgroundColor = Color{ 235,232,230 };
-				styles.setStyle("progress", style);
-			}
-			else
-			{
-				// dark
-				style.backgroundColor = Color{ 56,56,59 };
-				styles.setStyle("button", style);
+		// cached, kept current by WM_SETTINGCHANGE
+		static bool isDarkMode()
+		{
+			return theme().dark_.load(std::memory_order_relaxed);
+		}
 
-				style.backgroundColor = Color{ 67,67,70 };
-				styles.setStyle("button:hover", style);
+		using OnThemeChangedFunc = std::function<void(bool darkMode)>;
 
-				style.backgroundColor = Color{ 100,100,103 };
-				styles.setStyle("button:press", style);
+		// fn runs on the ui thread when the system switches between light and dark
+		static void setOnThemeChanged(const OnThemeChangedFunc& fn)
+		{
+			theme().onChanged_ = fn;
+		}
 
-				style.color = Color{ 53,132,228 };
-				style.backgroundColor = Color{ 81,81,85 };
-				styles.setStyle("progress", style);
-			}
+		using RunFunc = std::function<void()>;
+		using Task = utils::TaskPool::Task;
+
+		// fn runs on a worker thread, chain thenOnUI() to continue on the ui thread
+		static Task submit(const RunFunc& fn)
+		{
+			return pool().submit(fn);
+		}
 
-			style = Style::defaultStyle(darkMode);
-			style.radius = 0;
-			styles.setStyle("CloseButton", style);
+	private:
+		enum { DrainMessage = WM_APP + 1 };
+
+		struct Theme
+		{
+			std::atomic<bool> dark_{ false };
+			OnThemeChangedFunc onChanged_;
+		};
 
-			style.backgroundColor = Color{ 196,43,28 };
-			styles.setStyle("CloseButton:hover", style);
+		static Theme& theme()
+		{
+			static Theme t;
+			return t;
+		}
 
-			style.backgroundColor = Color{ 181,43,30 };
-			styles.setStyle("CloseButton:press", style);
+		// every top level window gets the broadcast, report real changes only
+		static void onThemeChanged()
+		{
+			bool dark = queryDarkMode();
+			if (theme().dark_.exchange(dark) != dark && theme().onChanged_)
+				theme().onChanged_(dark);
 		}
 
-		static bool isDarkMode()
+		static bool queryDarkMode()
 		{
 			HKEY key;
 			auto ret = RegOpenKeyEx(HKEY_CURRENT_USER, L"Software\\Microsoft\\Windows\\CurrentVersion\\Themes\\Personalize", 0, KEY_READ, &key);
@@ -895,7 +5972,38 @@ namespace minui
 			return buf[0] == 0;
 		}
 
-	private:
+		static HWND& messageWindow()
+		{
+			static HWND hwnd = NULL;
+			return hwnd;
+		}
+
+		// iterate() took WM_QUIT off the queue
+		static bool& quitReceived()
+		{
+			static bool quit = false;
+			return quit;
+		}
+
+		static LRESULT MessageProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
+		{
+			if (msg == DrainMessage)
+			{
+				pool().drainUI();
+				return 0;
+			}
+			return DefWindowProc(hwnd, msg, wParam, lParam);
+		}
+
+		static utils::TaskPool& pool()
+		{
+			static utils::TaskPool tasks([]()
+			{
+				PostMessage(messageWindow(), DrainMessage, 0, 0);
+			});
+			return tasks;
+		}
+
 		static bool initDpiAwareness()
 		{
 			using SetProcessDpiAwarenessFunc = BOOL(*)(void*);
@@ -920,14 +6028,13 @@ namespace minui
 	{
 	public:
 		Label()
-			: text_(nullptr)
 		{
 			setStyleName("label");
 		}
 
 		const char* text() const
 		{
-			return text_;
+			return text_.c_str();
 		}
 
 		void setText(const char* text)
@@ -938,7 +6045,7 @@ namespace minui
 	protected:
 		void draw(Painter& painter) override
 		{
-			if (text_)
+			if (text_.c_str())
 			{
 				auto style = Styles::instance().getStyle(styleName());
 				painter.drawText(rect(), text_, style);
@@ -946,7 +6053,7 @@ namespace minui
 		}
 
 	private:
-		const char* text_;
+		utils::String text_;
 	};
 
 
@@ -960,6 +6067,8 @@ namespace minui
 			Press
 		};
 
+		enum { TransitionTime = 120 }; // ms
+
 		static const char* stateString(State state)
 		{
 			const char* strings[] = { "", ":hover", ":press" };
@@ -969,12 +6078,17 @@ namespace minui
 		using OnClickFunc = std::function<void()>;
 
 		Button()
-			: text_(nullptr)
-			, state_(Normal)
+			: state_(Normal)
 		{
 			setStyleName("button");
 		}
 
+		// background cross-fade between states, 0 switches at once
+		void setTransition(int msec)
+		{
+			transition_ = msec;
+		}
+
 		State state() const
 		{
 			return state_;
@@ -982,7 +6096,7 @@ namespace minui
 
 		const char* text() const
 		{
-			return text_;
+			return text_.c_str();
 		}
 
 		void setText(const char* text)
@@ -998,72 +6112,139 @@ namespace minui
 	protected:
 		void draw(Painter& painter) override
 		{
-			auto name = std::string(styleName()) + stateString(state_);
-			auto style = Styles::instance().getStyle(name.c_str());
+			const char* name = painter.arena().concat(styleName(), stateString(state_));
+			auto style = Styles::instance().getStyle(name);
+			if (fade_ < 1)
+				style.backgroundColor = Animator::mix(from_, style.backgroundColor, fade_);
+
 			painter.withAA(rect(), [=](Painter& aaPainter)
 				{
 					aaPainter.fillRoundRect(rect(), style.radius, style.backgroundColor);
 				}
 			);
 
-			if (text_)
+			if (text_.c_str())
 				painter.drawText(rect(), text_, style); // text not need AA
 		}
 
+		// repaints come from setState() only, moving within the button costs nothing
 		void mouseMove(bool leave) override
 		{
-			state_ = leave ? Normal : Hover;
-			update();
+			setState(leave ? Normal : Hover);
 		}
 
 		void mouseButton(bool press) override
 		{
 			if (press)
 			{
-				state_ = Press;
+				setState(Press);
 			}
 			else
 			{
-				state_ = Hover;
+				setState(Hover);
 				if (onClick_)
 					onClick_();
 			}
-
-			update();
 		}
 
 	private:
-		const char* text_;
+		// fade from the colour on screen, which may be mid-transition itself
+		void setState(State state)
+		{
+			if (state == state_)
+				return;
+
+			char name[128]; // no heap on the pointer path
+			snprintf(name, sizeof(name), "%s%s", styleName(), stateString(state_));
+			auto& style = Styles::instance().getStyle(name);
+			from_ = fade_ < 1 ? Animator::mix(from_, style.backgroundColor, fade_) : style.backgroundColor;
+			state_ = state;
+			fade_ = 0;
+			animate(&fade_, transition_, Animator::EaseOut, [=](float t)
+			{
+				fade_ = t;
+				update();
+			});
+		}
+
+		utils::String text_;
 		State state_;
 		OnClickFunc onClick_;
+		Color from_ = { 0 };
+		float fade_ = 1.0f;
+		int transition_ = TransitionTime;
 	};
 
 	class Progress : public Widget
 	{
 	public:
+		enum { PulsePeriod = 1600 }; // ms, there and back
+
 		Progress()
 			: step_(0)
 		{
 			setStyleName("progress");
 		}
 
-		void setStep(float step)
+		// msec > 0 slides from the step shown now, leaves indeterminate mode
+		void setStep(float step, int msec = 0)
 		{
 			if (0 <= step && step <= 1.0)
 			{
-				step_ = step;
-				update();
+				setIndeterminate(false);
+				float from = step_;
+				animate(&step_, msec, Animator::EaseOut, [=](float t)
+				{
+					step_ = Animator::lerp(from, step, t);
+					update();
+				});
 			}
 		}
 
+		bool indeterminate() const
+		{
+			return indeterminate_;
+		}
+
+		// unknown amount of work: a block bounces along the bar on the frame clock, no calls needed
+		void setIndeterminate(bool v)
+		{
+			if (v == indeterminate_)
+				return;
+
+			indeterminate_ = v;
+			pulsing_ = false; // loop starts on the next paint, once the bar is in a window
+			if (!v)
+				animate(&pulse_, 0, Animator::Linear, [=](float) { pulse_ = 0; }); // replaces the loop
+			update();
+		}
+
 	protected:
 		void draw(Painter& painter) override
 		{
+			if (indeterminate_ && !pulsing_)
+			{
+				pulsing_ = true;
+				animate(&pulse_, PulsePeriod, Animator::Linear, [=](float t)
+				{
+					pulse_ = t;
+					update();
+				}, true);
+			}
+
 			auto style = Styles::instance().getStyle(styleName());
 			painter.withAA(rect(), [=](Painter& aaPainter)
 				{
 					aaPainter.fillRoundRect(rect(), style.radius, style.backgroundColor);
-					if (0 < step_)
+					if (indeterminate_)
+					{
+						float pos = Animator::ease(Animator::EaseInOut, pulse_ < 0.5f ? pulse_ * 2 : 2 - pulse_ * 2);
+						Rect block = rect();
+						block.width /= 4;
+						block.x += int((rect().width - block.width) * pos);
+						aaPainter.fillRoundRect(block, style.radius, style.color);
+					}
+					else if (0 < step_)
 					{
 						Rect stepRect = rect();
 						stepRect.width *= step_;
@@ -1075,6 +6256,9 @@ namespace minui
 
 	private:
 		float step_;
+		float pulse_ = 0; // phase of the bounce, 0 to 1
+		bool indeterminate_ = false;
+		bool pulsing_ = false;
 	};
 
 	class Image : public Widget
@@ -1092,14 +6276,34 @@ namespace minui
 			size_ = size;
 		}
 
+		// looked up in the active theme on paint, overrides setBmpData.
+		// Returns false, any number of images can follow the theme here.
+		bool setThemeImage(const char* name)
+		{
+			themeImage_ = name;
+			return false;
+		}
+
 	protected:
 		void draw(Painter& painter) override
 		{
-			if (bmp_)
+			const void* bmp = bmp_;
+			int size = size_;
+			if (themeImage_)
+			{
+				auto image = Styles::instance().theme().findImage(themeImage_);
+				if (image)
+				{
+					bmp = image->data;
+					size = image->size;
+				}
+			}
+
+			if (bmp)
 			{
 				painter.withAA(rect(), [=](Painter& aaPainter)
 					{
-						aaPainter.drawImage(rect(), (const uint8_t*)bmp_, size_);
+						aaPainter.drawImage(rect(), (const uint8_t*)bmp, size);
 					}
 				);
 			}
@@ -1108,6 +6312,201 @@ namespace minui
 	private:
 		const void* bmp_;
 		int size_;
+		const char* themeImage_ = nullptr;
+	};
+
+	class ListView : public Widget
+	{
+	public:
+		enum
+		{
+			ColumnCount = 4,
+			RowCount = 40, // max visible rows
+			TextLength = 128,
+			Padding = 6
+		};
+
+		using DataFunc = std::function<void(int row, int column, char* text, int length)>;
+
+		ListView()
+			: count_(0)
+			, first_(0)
+			, rowHeight_(24)
+			, columns_(1)
+			, wheel_(0)
+		{
+			setStyleName("listview");
+			for (int i = 0; i < ColumnCount; ++i)
+			{
+				widths_[i] = 0;
+				alignRight_[i] = false;
+			}
+			reload();
+		}
+
+		void setColumn(int column, int width, bool alignRight = false)
+		{
+			if (0 <= column && column < ColumnCount)
+			{
+				widths_[column] = width;
+				alignRight_[column] = alignRight;
+				if (column >= columns_)
+					columns_ = column + 1;
+				update();
+			}
+		}
+
+		void setRowHeight(int height)
+		{
+			if (height > 0)
+			{
+				rowHeight_ = height;
+				update();
+			}
+		}
+
+		void setDataSource(int count, const DataFunc& fn)
+		{
+			data_ = fn;
+			count_ = count;
+			first_ = 0;
+			reload();
+		}
+
+		int count() const
+		{
+			return count_;
+		}
+
+		void setCount(int count)
+		{
+			count_ = count;
+			scrollTo(first_);
+		}
+
+		int scrollRow() const
+		{
+			return first_;
+		}
+
+		void scrollTo(int row)
+		{
+			int last = count_ - pageRows();
+			if (row > last)
+				row = last;
+			if (row < 0)
+				row = 0;
+
+			if (row != first_)
+			{
+				first_ = row;
+				update();
+			}
+		}
+
+		// drop all bound rows, next paint fetches visible rows again
+		void reload()
+		{
+			for (auto& row : rows_)
+				row.index = -1;
+			update();
+		}
+
+	protected:
+		void draw(Painter& painter) override
+		{
+			auto& style = Styles::instance().getStyle(styleName());
+			painter.fillRect(rect(), style.backgroundColor);
+
+			int visible = visibleRows();
+			for (int i = 0; i < visible; ++i)
+			{
+				const Row& row = bindRow(first_ + i);
+				Rect cell = { rect().x, rect().y + i * rowHeight_, 0, rowHeight_ };
+				for (int c = 0; c < columns_; ++c)
+				{
+					cell.width = columnWidth(c);
+					Rect textRect = { cell.x + Padding, cell.y, cell.width - Padding * 2, cell.height };
+					painter.drawText(textRect, row.text[c], style, alignRight_[c] ? Painter::AlignRight : Painter::AlignLeft);
+					cell.x += cell.width;
+				}
+			}
+		}
+
+		// precision touchpads send fractions of a notch, the remainder waits for the next one
+		void mouseWheel(int delta) override
+		{
+			wheel_ += delta;
+			int notches = wheel_ / WHEEL_DELTA;
+			if (notches)
+			{
+				wheel_ -= notches * WHEEL_DELTA;
+				scrollTo(first_ - notches * 3);
+			}
+		}
+
+	private:
+		struct Row
+		{
+			int index;
+			char text[ColumnCount][TextLength];
+		};
+
+		// rows that fit the height, independent of the scroll position
+		int pageRows() const
+		{
+			int rows = rect().height / rowHeight_;
+			return rows > RowCount ? RowCount : rows;
+		}
+
+		int visibleRows() const
+		{
+			int rows = pageRows();
+			if (rows > count_ - first_)
+				rows = count_ - first_;
+			return rows > 0 ? rows : 0;
+		}
+
+		int columnWidth(int column) const
+		{
+			if (widths_[column] > 0)
+				return widths_[column];
+
+			// unsized column takes the rest
+			int width = rect().width;
+			for (int i = 0; i < columns_; ++i)
+				width -= widths_[i];
+			return width > 0 ? width : 0;
+		}
+
+		// rows recycle by slot, scrolling only fetches rows which are new in view
+		const Row& bindRow(int index)
+		{
+			Row& row = rows_[index % RowCount];
+			if (row.index != index)
+			{
+				row.index = index;
+				for (int c = 0; c < columns_; ++c)
+				{
+					row.text[c][0] = 0;
+					if (data_)
+						data_(index, c, row.text[c], TextLength);
+					row.text[c][TextLength - 1] = 0;
+				}
+			}
+			return row;
+		}
+
+	private:
+		DataFunc data_;
+		int count_;
+		int first_;
+		int rowHeight_;
+		int columns_;
+		int wheel_; // wheel delta short of a notch
+		int widths_[ColumnCount];
+		bool alignRight_[ColumnCount];
+		Row rows_[RowCount];
 	};
 
 	inline bool Window::create()
@@ -1122,9 +6521,21 @@ namespace minui
 		MARGINS margin = { 1,1,1,1 };
 		::DwmExtendFrameIntoClientArea(hwnd, &margin);
 
-		hwnd_ = hwnd;
-		SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)this);
-		return true;
+		hwnd_ = hwnd;
+		SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)this);
+		return true;
+	}
+
+	inline void Styles::setTheme(Theme* theme)
+	{
+		theme_.store(theme ? theme : &Theme::builtin(Application::isDarkMode()), std::memory_order_release);
+		EnumThreadWindows(GetCurrentThreadId(), invalidateWindow, 0);
+	}
+
+	inline void Window::onSettingChange(LPCWSTR area)
+	{
+		if (area && wcscmp(area, L"ImmersiveColorSet") == 0)
+			Application::onThemeChanged();
 	}
 
 	inline void Window::show()
@@ -1142,8 +6553,8 @@ namespace minui
 				Rect rect = close_->rect();
 				painter.withAA(rect, [=](Painter& aaPainter)
 					{
-						auto name = std::string("CloseButton") + Button::stateString(close_->state());
-						auto& style = Styles::instance().getStyle(name.c_str());
+						const char* name = aaPainter.arena().concat("CloseButton", Button::stateString(close_->state()));
+						auto& style = Styles::instance().getStyle(name);
 						// draw 12 x 12  x
 						int xCenter = rect.x + rect.width / 2;
 						int yCenter = rect.y + rect.height / 2;
@@ -1173,20 +6584,16 @@ namespace minui
 
 #endif
 
-#ifdef __linux__
-
-#include <dlfcn.h>
-#include <unistd.h>
-
-#include <cstdint>
-#include <cstring>
+#if defined(__linux__) && !defined(MINUI_SOFTWARE)
 
-#include <string>
-#include <thread>
-#include <mutex>
 #include <sstream>
-#include <functional>
-#include <condition_variable>
+
+#define MINUI_FONT_SIZE 14
+#define MINUI_FONT_FAMILY "sans", NULL
+#define MINUI_FONT_CSS "sans,"
+#define MINUI_CSS_HEADERBAR \
+	"headerbar { border: 0px; outline: none; background-image: none; box-shadow: none; text-shadow: none; }\n" \
+	"headerbar button { color: rgb(110, 110, 110); outline: none; box-shadow: none; -gtk-icon-shadow: none; }\n"
 
 namespace minui
 {
@@ -1204,6 +6611,9 @@ namespace minui
 		using Application = void;
 		using Callback = void(*)();
 		using SourceFunc = bool(*)(void*);
+		using FdFunc = bool(*)(int fd, int cond, void*);
+		using NotifyFunc = void(*)(void* obj, void* pspec, void* data);
+		using TickFunc = bool(*)(void* w, void* clock, void* data);
 
 		enum
 		{
@@ -1212,12 +6622,31 @@ namespace minui
 			SOURCE_REMOVE = false,
 			SOURCE_CONTINUE = true,
 
+			PRIORITY_DEFAULT = 0, // input events, ahead of gdk layout and redraw (120)
+			PRIORITY_LOW = 300,
+
 			APPLICATION_DEFAULT_FLAGS = 0,
 
 			PACK__START = 0,
 			PACK_END = 1,
 
 			STYLE_PROVIDER_PRIORITY_APPLICATION = 600,
+
+			IO_IN = 1,
+			IO_ERR = 8,
+			IO_HUP = 16,
+
+			ELLIPSIZE_END = 3,
+
+			SCROLL_UP = 0,
+			SCROLL_DOWN = 1,
+			SCROLL_SMOOTH = 4,
+			SCROLL_MASK = 1 << 21,
+			SMOOTH_SCROLL_MASK = 1 << 23,
+			EVENT_CONTROLLER_SCROLL_VERTICAL = 1,
+
+			MEMORY_R8G8B8A8 = 5, // GdkMemoryFormat, gdk-pixbuf's layouts
+			MEMORY_R8G8B8 = 7,
 		};
 
 		class Library
@@ -1264,11 +6693,23 @@ namespace minui
 				#define SYMBOL_WITH(p, sym) p = (decltype(p))dlsym(gtk_, sym); if (!p) return false
 				#define SYMBOL_SELECT(p, sym4, sym3) p = (decltype(p))dlsym(gtk_, isGtk3_ ? sym3 : sym4); if (!p) return false
 				SYMBOL(g_signal_connect_data);
+				SYMBOL(g_object_get);
+				SYMBOL(g_free);
+				SYMBOL(g_error_free);
+				SYMBOL(g_object_unref);
 				SYMBOL(g_application_hold);
 				SYMBOL(g_application_run);
+				SYMBOL(g_application_register);
 				SYMBOL(g_application_quit);
+				SYMBOL(g_main_context_iteration);
+				SYMBOL(g_main_context_wakeup);
 				SYMBOL(g_idle_add);
+				SYMBOL(g_idle_add_full);
 				SYMBOL(g_timeout_add);
+				SYMBOL(g_timeout_add_full);
+				SYMBOL(g_source_remove);
+				SYMBOL(g_unix_fd_add);
+				SYMBOL(g_get_monotonic_time);
 				SYMBOL(g_memory_input_stream_new_from_data);
 				SYMBOL(g_input_stream_close);
 
@@ -1293,40 +6734,67 @@ namespace minui
 				SYMBOL(gtk_widget_queue_draw);
 				SYMBOL(gtk_widget_set_visible);
 				SYMBOL(gtk_widget_set_size_request);
+				SYMBOL(gtk_widget_set_opacity);
+				SYMBOL(gtk_widget_add_tick_callback);
+				SYMBOL(gtk_widget_remove_tick_callback);
+				SYMBOL(gdk_frame_clock_get_frame_time);
 
 				SYMBOL(gtk_fixed_new);
 				SYMBOL_WITH(gtk_fixed_put_, "gtk_fixed_put");
+				SYMBOL_WITH(gtk_fixed_move_, "gtk_fixed_move");
 
 				SYMBOL(gtk_label_new);
 				SYMBOL(gtk_label_set_text);
+				SYMBOL(gtk_label_set_xalign);
+				SYMBOL(gtk_label_set_ellipsize);
 
 				SYMBOL(gtk_button_new);
 				SYMBOL(gtk_button_set_label);
 
 				SYMBOL(gtk_progress_bar_new);
 				SYMBOL(gtk_progress_bar_set_fraction);
+				SYMBOL(gtk_progress_bar_pulse);
 
 				SYMBOL(gtk_image_new);
 				SYMBOL(gtk_image_set_from_pixbuf);
+				SYMBOL(gtk_widget_get_scale_factor);
 
 				SYMBOL(gtk_css_provider_new);
 				SYMBOL_WITH(gtk_css_provider_load_from_data_, "gtk_css_provider_load_from_data");
 
 				SYMBOL(gdk_pixbuf_new_from_stream);
 				SYMBOL(gdk_pixbuf_new_from_stream_at_scale);
+				SYMBOL(gdk_pixbuf_get_width);
+				SYMBOL(gdk_pixbuf_get_height);
+				SYMBOL(gdk_pixbuf_get_rowstride);
+				SYMBOL(gdk_pixbuf_get_has_alpha);
+				SYMBOL(gdk_pixbuf_read_pixel_bytes);
 				SYMBOL(gdk_display_get_default);
+				SYMBOL(gtk_settings_get_default);
 
 				if (isGtk3_)
 				{
 					SYMBOL(gtk_widget_get_style_context);
 					SYMBOL(gtk_style_context_add_class);
 					SYMBOL(gtk_style_context_add_provider_for_screen);
+					SYMBOL(gtk_style_context_remove_provider_for_screen);
 					SYMBOL(gdk_display_get_default_screen);
+					SYMBOL(gtk_event_box_new);
+					SYMBOL(gtk_container_add);
+					SYMBOL(gtk_widget_add_events);
+					SYMBOL(gdk_event_get_scroll_direction);
+					SYMBOL(gdk_event_get_scroll_deltas);
 				}
 				else
 				{
 					SYMBOL_WITH(gtk_widget_add_css_class_, "gtk_widget_add_css_class");
 					SYMBOL_WITH(gtk_style_context_add_provider_for_display_, "gtk_style_context_add_provider_for_display");
+					SYMBOL_WITH(gtk_style_context_remove_provider_for_display_, "gtk_style_context_remove_provider_for_display");
+					SYMBOL(gtk_event_controller_scroll_new);
+					SYMBOL(gtk_widget_add_controller);
+					SYMBOL(gtk_image_set_from_paintable);
+					SYMBOL(gdk_memory_texture_new);
+					SYMBOL(g_bytes_unref);
 				}
 
 				#undef SYMBOL
@@ -1340,12 +6808,24 @@ namespace minui
 			#define FUNC(RET, NAME, PARAMS) RET(*NAME)PARAMS = nullptr
 			// glib
 			FUNC(int,  g_signal_connect_data, (void* obj, const char* sig, Callback callback, void* data, void* destroy, int flags));
+			FUNC(void, g_object_get,          (void* obj, const char* name, ...));
+			FUNC(void, g_free,                (void* mem));
+			FUNC(void, g_error_free,          (Error* error));
+			FUNC(void, g_object_unref,        (void* obj));
 			FUNC(void, g_application_hold,    (void* app));
 			FUNC(int,  g_application_run,     (void* app, int argc, const char** argv));
+			FUNC(bool, g_application_register, (void* app, void* cancel, void* err));
 			FUNC(void, g_application_quit,    (void* app));
+			FUNC(bool, g_main_context_iteration, (void* context, bool mayBlock));
+			FUNC(void, g_main_context_wakeup,    (void* context));
 
 			FUNC(int,  g_idle_add,    (SourceFunc fn, void* data));
+			FUNC(int,  g_idle_add_full, (int priority, SourceFunc fn, void* data, void* notify));
 			FUNC(int,  g_timeout_add, (int interval, SourceFunc fn, void* data));
+			FUNC(int,  g_timeout_add_full, (int priority, int interval, SourceFunc fn, void* data, void* notify));
+			FUNC(bool, g_source_remove, (int id));
+			FUNC(int,  g_unix_fd_add, (int fd, int cond, FdFunc fn, void* data));
+			FUNC(int64_t, g_get_monotonic_time, ());
 
 			FUNC(void*, g_memory_input_stream_new_from_data, (const void* data,  int len, void* destroy));
 			FUNC(void,  g_input_stream_close,                (void* s, void* cancel, void* err));
@@ -1390,6 +6870,10 @@ namespace minui
 
 			FUNC(void,  gtk_widget_set_visible, (void* w, bool v));
 			FUNC(void,  gtk_widget_set_size_request, (void* w, int width, int height));
+			FUNC(void,  gtk_widget_set_opacity, (void* w, double opacity));
+			FUNC(unsigned, gtk_widget_add_tick_callback, (void* w, TickFunc fn, void* data, void* destroy));
+			FUNC(void,  gtk_widget_remove_tick_callback, (void* w, unsigned id));
+			FUNC(int64_t, gdk_frame_clock_get_frame_time, (void* clock));
 
 			FUNC(void*, gtk_fixed_new, ());
 
@@ -1404,17 +6888,61 @@ namespace minui
 					(gtk4_fixed_put(gtk_fixed_put_))(fixed, child, x, y);
 			}
 
+			void gtk_fixed_move(void* fixed, void* child, int x, int y)
+			{
+				using gtk3_fixed_move = void(*)(void*, void*, int x, int y);
+				using gtk4_fixed_move = void(*)(void*, void*, double x, double y);
+
+				if (isGtk3_)
+					(gtk3_fixed_move(gtk_fixed_move_))(fixed, child, x, y);
+				else
+					(gtk4_fixed_move(gtk_fixed_move_))(fixed, child, x, y);
+			}
+
 			FUNC(void*, gtk_label_new, (const char* text));
 			FUNC(void,  gtk_label_set_text, (void* label, const char* text));
+			FUNC(void,  gtk_label_set_xalign, (void* label, float xalign));
+			FUNC(void,  gtk_label_set_ellipsize, (void* label, int mode));
 
 			FUNC(void*, gtk_button_new, ());
 			FUNC(void,  gtk_button_set_label, (void* btn, const char* text));
 
 			FUNC(void*, gtk_progress_bar_new, ());
 			FUNC(void,  gtk_progress_bar_set_fraction, (void* pgs, double step));
+			FUNC(void,  gtk_progress_bar_pulse, (void* pgs));
 
 			FUNC(void*, gtk_image_new, ());
 			FUNC(void,  gtk_image_set_from_pixbuf, (void* img, void* pixbuf));
+			FUNC(int,   gtk_widget_get_scale_factor, (void* w));
+
+			// device pixels per logical pixel to decode images at, a gtk3 image shows a pixbuf at its own size
+			int image_scale(void* img)
+			{
+				return isGtk3_ ? 1 : gtk_widget_get_scale_factor(img);
+			}
+
+			// takes the pixbuf, gtk4 gets a GdkMemoryTexture over the decoded pixels without a copy.
+			// The texture keeps its gpu upload for as long as it lives.
+			void* image_upload(void* pixbuf)
+			{
+				if (isGtk3_)
+					return pixbuf;
+
+				void* bytes = gdk_pixbuf_read_pixel_bytes(pixbuf); // refs the pixbuf
+				void* texture = gdk_memory_texture_new(gdk_pixbuf_get_width(pixbuf), gdk_pixbuf_get_height(pixbuf),
+					gdk_pixbuf_get_has_alpha(pixbuf) ? MEMORY_R8G8B8A8 : MEMORY_R8G8B8, bytes, gdk_pixbuf_get_rowstride(pixbuf));
+				g_bytes_unref(bytes);
+				g_object_unref(pixbuf);
+				return texture;
+			}
+
+			void gtk_image_set_from_upload(void* img, void* upload)
+			{
+				if (isGtk3_)
+					gtk_image_set_from_pixbuf(img, upload);
+				else
+					gtk_image_set_from_paintable(img, upload);
+			}
 
 			FUNC(void*, gtk_css_provider_new, ());
 
@@ -1441,16 +6969,64 @@ namespace minui
 					gtk_style_context_add_provider_for_display_(dis, prov, prvi);
 			}
 
+			void gtk_style_context_remove_provider_for_display(void* dis, void* prov)
+			{
+				if (isGtk3_)
+					gtk_style_context_remove_provider_for_screen(gdk_display_get_default_screen(dis), prov);
+				else
+					gtk_style_context_remove_provider_for_display_(dis, prov);
+			}
+
 			// gdk
 			FUNC(void*, gdk_pixbuf_new_from_stream, (void* s, void* cancel, void* err));
 			FUNC(void*, gdk_pixbuf_new_from_stream_at_scale, (void* s, int width, int height, bool aspect_radio, void* cancel, void* err));
+			FUNC(int,   gdk_pixbuf_get_width, (void* pixbuf));
+			FUNC(int,   gdk_pixbuf_get_height, (void* pixbuf));
+			FUNC(int,   gdk_pixbuf_get_rowstride, (void* pixbuf));
+			FUNC(bool,  gdk_pixbuf_get_has_alpha, (void* pixbuf));
+			FUNC(void*, gdk_pixbuf_read_pixel_bytes, (void* pixbuf));
 			FUNC(void*, gdk_display_get_default, ());
+			FUNC(void*, gtk_settings_get_default, ());
 
 			// adwaita
 			FUNC(void,  adw_init,                     ());
 			FUNC(void*, adw_style_manager_get_default,());
 			FUNC(bool,  adw_style_manager_get_dark,   (void* mgr));
 
+			// libadwaita tracks the system color scheme, without it fall back to the gtk settings
+			bool is_dark_mode()
+			{
+				if (adw_)
+					return adw_style_manager_get_dark(adw_style_manager_get_default());
+
+				void* settings = gtk_settings_get_default();
+				if (!settings)
+					return false;
+
+				int preferDark = 0;
+				char* theme = nullptr;
+				g_object_get(settings, "gtk-application-prefer-dark-theme", &preferDark, "gtk-theme-name", &theme, nullptr);
+				bool dark = preferDark || (theme && strstr(theme, "-dark"));
+				g_free(theme);
+				return dark;
+			}
+
+			void connect_theme_changed(NotifyFunc fn, void* data)
+			{
+				if (adw_)
+				{
+					g_signal_connect_data(adw_style_manager_get_default(), "notify::dark", Callback(fn), data, nullptr, CONNECT_DEFAULT);
+					return;
+				}
+
+				void* settings = gtk_settings_get_default();
+				if (settings)
+				{
+					g_signal_connect_data(settings, "notify::gtk-application-prefer-dark-theme", Callback(fn), data, nullptr, CONNECT_DEFAULT);
+					g_signal_connect_data(settings, "notify::gtk-theme-name", Callback(fn), data, nullptr, CONNECT_DEFAULT);
+				}
+			}
+
 			void set_window_titlebar(void* win, void* titlebar)
 			{
 				if (isGtk3_)
@@ -1484,20 +7060,85 @@ namespace minui
 				}
 			}
 
+			// gtk3 delivers scroll events to widgets owning a GdkWindow only
+			void* scroll_box_new(void* child)
+			{
+				if (!isGtk3_)
+					return child;
+
+				void* box = gtk_event_box_new();
+				gtk_container_add(box, child);
+				gtk_widget_add_events(box, SCROLL_MASK | SMOOTH_SCROLL_MASK);
+				return box;
+			}
+
+			using OnScrollFunc = void(*)(double dy, void* data);
+			void connect_scroll(void* w, OnScrollFunc onScroll, void* data)
+			{
+				struct ScrollArg
+				{
+					OnScrollFunc onScroll_;
+					void* data_;
+				};
+				auto arg = new ScrollArg{onScroll, data};
+
+				if (isGtk3_)
+				{
+					using ScrollEventFunc = bool(*)(void* w, void* e, void* user);
+					g_signal_connect_data(w, "scroll-event", Callback(ScrollEventFunc([](void* w, void* e, void* user)->bool
+					{
+						auto arg = (ScrollArg*)user;
+						int direction = 0;
+						double dx = 0, dy = 0;
+						instance().gdk_event_get_scroll_direction(e, &direction);
+						if (direction == SCROLL_UP) dy = -1;
+						else if (direction == SCROLL_DOWN) dy = 1;
+						else if (direction == SCROLL_SMOOTH) instance().gdk_event_get_scroll_deltas(e, &dx, &dy);
+						arg->onScroll_(dy, arg->data_);
+						return true;
+					})), arg, nullptr, CONNECT_DEFAULT);
+				}
+				else
+				{
+					using ScrollFunc = bool(*)(void* ctrl, double dx, double dy, void* user);
+					void* ctrl = gtk_event_controller_scroll_new(EVENT_CONTROLLER_SCROLL_VERTICAL);
+					g_signal_connect_data(ctrl, "scroll", Callback(ScrollFunc([](void* ctrl, double dx, double dy, void* user)->bool
+					{
+						auto arg = (ScrollArg*)user;
+						arg->onScroll_(dy, arg->data_);
+						return true;
+					})), arg, nullptr, CONNECT_DEFAULT);
+					gtk_widget_add_controller(w, ctrl);
+				}
+			}
+
 		private:
 			// gtk3
 			FUNC(void*, gtk_widget_get_style_context, (void* w));
 			FUNC(void*, gtk_style_context_add_class,  (void* sc, const char* cls));
 			FUNC(void*, gdk_display_get_default_screen, (void* display));
 			FUNC(void,  gtk_style_context_add_provider_for_screen, (void* screen, void* prov, int prvi));
+			FUNC(void,  gtk_style_context_remove_provider_for_screen, (void* screen, void* prov));
+			FUNC(void*, gtk_event_box_new, ());
+			FUNC(void,  gtk_container_add, (void* container, void* child));
+			FUNC(void,  gtk_widget_add_events, (void* w, int events));
+			FUNC(bool,  gdk_event_get_scroll_direction, (void* e, int* direction));
+			FUNC(bool,  gdk_event_get_scroll_deltas, (void* e, double* dx, double* dy));
 
 			// gtk4
 			FUNC(void*, gtk_widget_add_css_class_,    (void* w, const char* cls));
 			FUNC(void, gtk_style_context_add_provider_for_display_, (void* display, void* prov, int prvi));
+			FUNC(void, gtk_style_context_remove_provider_for_display_, (void* display, void* prov));
+			FUNC(void*, gtk_event_controller_scroll_new, (int flags));
+			FUNC(void,  gtk_widget_add_controller, (void* w, void* ctrl));
+			FUNC(void,  gtk_image_set_from_paintable, (void* img, void* paintable));
+			FUNC(void*, gdk_memory_texture_new, (int width, int height, int format, void* bytes, size_t stride));
+			FUNC(void,  g_bytes_unref, (void* bytes));
 
 			// diff
 			void* gtk_window_new_ = nullptr;
 			void* gtk_fixed_put_ = nullptr;
+			void* gtk_fixed_move_ = nullptr;
 			void* gtk_css_provider_load_from_data_ = nullptr;
 			#undef FUNC
 		private:
@@ -1520,16 +7161,19 @@ namespace minui
 		{
 			std::mutex mtx_;
 			std::condition_variable cond_;
+			bool done_ = false;
 
 			void notify()
 			{
+				std::lock_guard<std::mutex> lock(mtx_);
+				done_ = true;
 				cond_.notify_one();
 			}
 
 			void wait()
 			{
 				std::unique_lock<std::mutex> lock(mtx_);
-				cond_.wait(lock);
+				cond_.wait(lock, [this]() { return done_; }); // may be notified before waiting
 			}
 		};
 	}
@@ -1582,6 +7226,17 @@ namespace minui
 	{
 		enum { FontFamilyCount = 6 };
 
+		// fields a derived style overrides, see Theme::setStyle
+		enum Field
+		{
+			ColorField = 1 << 0,
+			BackgroundColorField = 1 << 1,
+			RadiusField = 1 << 2,
+			FontSizeField = 1 << 3,
+			FontFamilyField = 1 << 4,
+			AllFields = (1 << 5) - 1
+		};
+
 		const char* name;
 		Color color;
 		Color backgroundColor;
@@ -1591,7 +7246,7 @@ namespace minui
 
 		static const Style& defaultStyle(bool isDark = false)
 		{
-			static Style styles[2] =
+			static constexpr Style styles[2] =
 			{
 				// light
 				{
@@ -1599,8 +7254,8 @@ namespace minui
 					Color{50, 50, 50},
 					Color{250, 250, 251},
 					6,
-					14,
-					{"sans", NULL}
+					MINUI_FONT_SIZE,
+					{ MINUI_FONT_FAMILY }
 				},
 				// dark
 				{
@@ -1608,8 +7263,8 @@ namespace minui
 					Color{250, 250, 250},
 					Color{ 34,34,38 },
 					6,
-					14,
-					{"sans", NULL}
+					MINUI_FONT_SIZE,
+					{ MINUI_FONT_FAMILY }
 				}
 			};
 			return styles[isDark];
@@ -1629,45 +7284,96 @@ namespace minui
 		~Handle() = default;
 	};
 
-	class Styles : public Handle
+	class Image;
+
+	// Built-in light and dark styles, read-only tables and css text resolved at compile time.
+	template <typename T = void>
+	struct DefaultStyles
+	{
+		static constexpr Style light[] = { MINUI_STYLES_LIGHT(MINUI_STYLE) };
+		static constexpr Style dark[] = { MINUI_STYLES_DARK(MINUI_STYLE) };
+
+		static constexpr const char lightCss[] =
+			MINUI_CSS_HEADERBAR
+			MINUI_STYLES_LIGHT(MINUI_STYLE_CSS);
+		static constexpr const char darkCss[] =
+			MINUI_CSS_HEADERBAR
+			MINUI_STYLES_DARK(MINUI_STYLE_CSS);
+	};
+
+	template <typename T> constexpr Style DefaultStyles<T>::light[];
+	template <typename T> constexpr Style DefaultStyles<T>::dark[];
+	template <typename T> constexpr const char DefaultStyles<T>::lightCss[];
+	template <typename T> constexpr const char DefaultStyles<T>::darkCss[];
+
+	// A named bundle of styles and themed images, prepared once per theme.
+	// Styles::setTheme() switches bundles by swapping the css provider.
+	class Theme : public Handle, public utils::ThemeBase<Style>
 	{
 	public:
-		enum { MaxCount = 32 };
+		explicit Theme(const char* name = nullptr)
+			: ThemeBase(name)
+		{
+		}
 
-		static Styles& instance()
+		// read-only styles, usually a constexpr table, setStyle() overrides them.
+		// css is the table's pre-rendered text, without it the css is generated.
+		template <size_t N>
+		Theme(const char* name, const Style (&table)[N], const char* css = nullptr)
+			: ThemeBase(name, table, int(N))
+			, tableCss_(css)
 		{
-			static Styles styles;
-			return styles;
 		}
 
-		bool setStyle(const char* name, Style style)
+		static Theme& builtin(bool darkMode)
 		{
-			style.name = name;
-			int index = findStyle(name);
-			if (index == -1)
-				return addStyle(style);
+			static Theme light("light", DefaultStyles<>::light, DefaultStyles<>::lightCss);
+			static Theme dark("dark", DefaultStyles<>::dark, DefaultStyles<>::darkCss);
+			return darkMode ? dark : light;
+		}
 
-			styles_[index] = style;
-			return true;
+		// render the css ahead of the first switch
+		void prepare()
+		{
+			updateCss();
 		}
 
-		const Style& getStyle(const char* name) const
+	private:
+		friend class Styles;
+
+		const char* tableCss_ = nullptr;
+
+		static gtk::CssProvider* newCss();
+		void updateCss();
+
+		gtk::CssProvider* css_ = nullptr;
+	};
+
+	class Styles : public Handle, public utils::StylesBase<Theme, Style>
+	{
+	public:
+		enum { ImageCount = 32 }; // themed images
+
+		static Styles& instance()
 		{
-			int index = findStyle(name);
-			if (index != -1)
-				return styles_[index];
-			return Style::defaultStyle();
+			static Styles styles;
+			return styles;
 		}
 
+		// nullptr goes back to the built-in theme, swaps the css provider and themed images
+		void setTheme(Theme* theme);
+
 		void update()
 		{
-			updateCss();
+			theme().updateCss();
 		}
 
 	private:
-		friend class Application;		
-		void initialize()
+		friend class Application;
+		friend class Image;
+		void initialize(Theme* theme)
 		{
+			theme_ = theme;
 			initCss();
 		}
 
@@ -1677,33 +7383,30 @@ namespace minui
 
 		}
 
-		int findStyle(const char* name) const
-		{
-			for (int i = 0; i < MaxCount; ++i)
-			{
-				const Style& style = styles_[i];
-				if (!style.name)
-					return -1;
+		void initCss();
 
-				if (strcmp(style.name, name) == 0)
-					return i;
-			}
-			return -1;
+		// ui thread, true when all ImageCount slots are taken like Window::addWidget
+		bool addImage(Image* image)
+		{
+			if (imageIndex_ == ImageCount)
+				return true;
+			images_[imageIndex_++] = image;
+			return false;
 		}
 
-		bool addStyle(Style style)
+		void removeImage(Image* image)
 		{
-			if (index_ < MaxCount)
-				styles_[index_++] = style;
-			return index_ <= MaxCount;
+			for (int i = 0; i < imageIndex_; ++i)
+			{
+				if (images_[i] == image)
+				{
+					images_[i] = images_[--imageIndex_];
+					break;
+				}
+			}
 		}
-
-		void initCss();
-		void updateCss();
-
-		gtk::CssProvider* css_ = nullptr;
-		Style styles_[MaxCount];
-		int index_ = 0;
+		Image* images_[ImageCount];
+		int imageIndex_ = 0;
 	};
 
 	class Window;
@@ -1711,7 +7414,7 @@ namespace minui
 	class Widget : public Handle
 	{
 	public:
-		virtual ~Widget() = default;
+		virtual ~Widget();
 
 		const char* styleName() const
 		{
@@ -1737,6 +7440,14 @@ namespace minui
 
 		void setVisible(bool v);
 
+		float opacity() const
+		{
+			return opacity_;
+		}
+
+		// msec > 0 fades from the current opacity
+		void setOpacity(float opacity, int msec = 0);
+
 	protected:
 		Widget() = default;
 
@@ -1745,6 +7456,9 @@ namespace minui
 			handle_ = handle;
 		}
 
+		// ui thread, fn runs on every frame until msec elapsed, starting the same key again replaces it
+		void animate(const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat = false);
+
 	private:
 		friend class Window;
 		void setWindow(Window* window)
@@ -1762,13 +7476,20 @@ namespace minui
 		Window* window_ = nullptr;
 		Rect rect_ = {0};
 		const char* name_ = nullptr;
+		float opacity_ = 1.0f; // ui thread
 		bool visible_ = true;
 	};
 	
 	class Application : public Handle
 	{
 	public:
-		static bool initialize(const char* appId)
+		enum Loop
+		{
+			OwnThread, // a ui thread of its own runs the GLib main loop
+			HostThread // the calling thread is the ui thread and runs exec(), pump() or iterate()
+		};
+
+		static bool initialize(const char* appId, Loop loop = OwnThread)
 		{
 			bool ok = gtk::lib().initialize();
 			if (!ok)
@@ -1777,138 +7498,317 @@ namespace minui
 			gtk::lib().gtk_init();
 			gtk::lib().adw_init();
 
-			instance().app_ = gtk::lib().gtk_application_new(appId, gtk::APPLICATION_DEFAULT_FLAGS);
-			gtk::lib().g_signal_connect_data(instance().app_, "activate", (gtk::Callback)([](){}), nullptr, nullptr, gtk::CONNECT_DEFAULT);
+			Application& app = instance();
+			app.app_ = gtk::lib().gtk_application_new(appId, gtk::APPLICATION_DEFAULT_FLAGS);
+			gtk::lib().g_signal_connect_data(app.app_, "activate", (gtk::Callback)([](){}), nullptr, nullptr, gtk::CONNECT_DEFAULT);
+
+			app.loop_ = loop;
+			if (loop == HostThread)
+			{
+				Trace::setThreadName("minui-ui");
+				app.uiId_ = std::this_thread::get_id();
+				gtk::lib().g_application_register(app.app_, nullptr, nullptr);
+			}
+			else
+			{
+				app.ui_ = std::thread([]()
+				{
+					Trace::setThreadName("minui-ui");
+					auto app = instance().app_;
+					gtk::lib().g_application_hold(app); // never stop
+					gtk::lib().g_application_run(app, 0, nullptr);
+				});
+				app.uiId_ = app.ui_.get_id();
+			}
 
-			instance().ui_ = std::thread([]()
+			runOnUI([]()
 			{
-				auto app = instance().app_;
-				gtk::lib().g_application_hold(app); // never stop
-				gtk::lib().g_application_run(app, 0, nullptr);
+				instance().dark_ = gtk::lib().is_dark_mode();
+				gtk::lib().connect_theme_changed(onThemeNotify, nullptr);
 			});
 
-			Styles::instance().initialize();
-			setStyles(isDarkMode());
+			Styles::instance().initialize(&Theme::builtin(isDarkMode()));
 			return true;
 		}
 
 		static void exec()
 		{
-			instance().ui_.join();
+			Application& app = instance();
+			if (app.loop_ == OwnThread)
+			{
+				app.ui_.join();
+				return;
+			}
+
+			while (!app.quit_)
+				gtk::lib().g_main_context_iteration(nullptr, true);
+			app.quit_ = false;
 		}
 
 		static void quit()
 		{
-			gtk::lib().g_application_quit(instance().app_);
+			Application& app = instance();
+			if (app.loop_ == OwnThread)
+			{
+				gtk::lib().g_application_quit(app.app_);
+				return;
+			}
+
+			app.quit_ = true;
+			gtk::lib().g_main_context_wakeup(nullptr);
 		}
 
-		static void setStyles(bool darkMode)
+		// HostThread only: wait up to timeout ms for an event (-1 without limit), then dispatch all that is pending.
+		// Returns false once after quit().
+		static bool pump(int timeout)
 		{
-			Styles& styles = Styles::instance();
-			auto style = Style::defaultStyle(darkMode);
-			styles.setStyle("window", style);
-			styles.setStyle("label", style);
-			styles.setStyle("image", style);
-			styles.setStyle("headerbar", style);
-
-			if (!darkMode)
+			Application& app = instance();
+			if (timeout < 0)
 			{
-				// light
-				style.backgroundColor = Color{ 230, 230, 230 };
-				styles.setStyle("button", style);
-
-				style.backgroundColor = Color{ 220,220,221 };
-				styles.setStyle("button:hover", style);
-
-				style.backgroundColor = Color{ 190,190,192 };
-				styles.setStyle("button:press", style);
-
-				style.color = Color{ 53,132,228 };
-				style.backgroundColor = Color{ 235,232,230 };
-				styles.setStyle("progress", style);
+				gtk::lib().g_main_context_iteration(nullptr, true);
 			}
-			else
+			else if (timeout > 0)
 			{
-				// dark
-				style.backgroundColor = Color{ 56,56,59 };
-				styles.setStyle("button", style);
+				bool fired = false;
+				int id = gtk::lib().g_timeout_add(timeout, [](void* data) -> bool
+				{
+					*(bool*)data = true;
+					return gtk::SOURCE_REMOVE;
+				}, &fired);
+				gtk::lib().g_main_context_iteration(nullptr, true);
+				if (!fired)
+					gtk::lib().g_source_remove(id);
+			}
 
-				style.backgroundColor = Color{ 67,67,70 };
-				styles.setStyle("button:hover", style);
+			iterate();
+			return !app.quit_.exchange(false);
+		}
 
-				style.backgroundColor = Color{ 100,100,103 };
-				styles.setStyle("button:press", style);
+		// HostThread only: dispatch pending events without blocking, returns whether there were any
+		static bool iterate()
+		{
+			bool any = false;
+			while (gtk::lib().g_main_context_iteration(nullptr, false))
+				any = true;
+			return any;
+		}
 
-				style.color = Color{ 53,132,228 };
-				style.backgroundColor = Color{ 81,81,85 };
-				styles.setStyle("progress", style);
-			}
-			styles.update();
+		// switch to the built-in light or dark theme
+		static void setStyles(bool darkMode)
+		{
+			Styles::instance().setTheme(&Theme::builtin(darkMode));
+		}
+
+		// fill a theme bundle with the built-in styles
+		static void setStyles(Theme& theme, bool darkMode)
+		{
+			const auto& table = darkMode ? DefaultStyles<>::dark : DefaultStyles<>::light;
+			for (const Style& style : table)
+				theme.setStyle(style.name, style);
 		}
 
+		// cached, kept current by the theme notifications
 		static bool isDarkMode()
 		{
-			auto styleMgr = gtk::lib().adw_style_manager_get_default();
-			return gtk::lib().adw_style_manager_get_dark(styleMgr);
+			return instance().dark_.load(std::memory_order_relaxed);
+		}
+
+		using OnThemeChangedFunc = std::function<void(bool darkMode)>;
+
+		// fn runs on the ui thread when the system switches between light and dark
+		static void setOnThemeChanged(const OnThemeChangedFunc& fn)
+		{
+			runOnUI([=]()
+			{
+				instance().onThemeChanged_ = fn;
+			});
 		}
 
 		using RunFunc = std::function<void()>;
 
-		static void runOnUI(const RunFunc& fn)
+		enum Lane
+		{
+			Normal, // default idle priority, behind gtk's layout and redraw
+			High,   // input feedback, close, page switch: with input events, ahead of layout and redraw
+			Bulk    // log appends, list refreshes: low priority, at most BulkBudget ms of every frame
+		};
+
+		static void runOnUI(const RunFunc& fn, Lane lane = Normal)
 		{
-			if (std::this_thread::get_id() == instance().ui_.get_id())
+			Application& app = instance();
+			if (std::this_thread::get_id() == app.uiId_)
 			{
 				fn();
 				return;
 			}
 
-			struct RunContext : utils::ConditionContext
-			{
-				RunFunc run_;
-			};
-
 			RunContext ctx;
 			ctx.run_ = fn;
+			ctx.posted_ = Metrics::enabled() ? Metrics::now() : 0;
 
-			gtk::lib().g_idle_add((gtk::SourceFunc)([](void* data) -> bool
+			auto onRun = [](void* data) -> bool
 			{
-				auto ctx = (RunContext*)data;
-				ctx->run_();
-				ctx->notify();
+				run((RunContext*)data);
 				return gtk::SOURCE_REMOVE;
-			}), &ctx);
+			};
+
+			if (lane == High)
+			{
+				gtk::lib().g_idle_add_full(gtk::PRIORITY_DEFAULT, onRun, &ctx, nullptr);
+			}
+			else if (lane == Bulk)
+			{
+				// one source drains the whole lane
+				std::lock_guard<std::mutex> lock(app.bulkMtx_);
+				app.bulk_.push_back(&ctx);
+				if (!app.bulkScheduled_)
+				{
+					app.bulkScheduled_ = true;
+					gtk::lib().g_idle_add_full(gtk::PRIORITY_LOW, onBulk, nullptr, nullptr);
+				}
+			}
+			else
+			{
+				gtk::lib().g_idle_add(onRun, &ctx);
+			}
 
+			Trace::Scope trace("runOnUI_wait");
 			ctx.wait();
 			return;
 		}
 
+		using Task = utils::TaskPool::Task;
+
+		// fn runs on a worker thread, chain thenOnUI() to continue on the ui thread
+		static Task submit(const RunFunc& fn)
+		{
+			return pool().submit(fn);
+		}
+
 	private:
 		friend class Window;
+
+		enum { BulkBudget = 4 }; // ms
+
+		struct RunContext : utils::ConditionContext
+		{
+			RunFunc run_;
+			int64_t posted_;
+		};
+
 		static Application& instance()
 		{
 			static Application app;
 			return app;
 		}
 
+		static void run(RunContext* ctx)
+		{
+			if (ctx->posted_)
+				Metrics::record(Metrics::RunOnUIQueue, Metrics::now() - ctx->posted_);
+			{
+				Metrics::Scope scope(Metrics::RunOnUIExec);
+				Trace::Scope trace("runOnUI");
+				ctx->run_();
+			}
+			ctx->notify();
+		}
+
+		// the bulk lane in order, out of budget it sleeps until the next frame so input and redraw go first
+		static bool onBulk(void*)
+		{
+			Application& app = instance();
+			int64_t end = Metrics::now() + int64_t(BulkBudget) * 1000000;
+			for (;;)
+			{
+				RunContext* ctx;
+				{
+					std::lock_guard<std::mutex> lock(app.bulkMtx_);
+					if (app.bulk_.empty())
+					{
+						app.bulkScheduled_ = false;
+						return gtk::SOURCE_REMOVE;
+					}
+					if (Metrics::now() >= end)
+						break;
+
+					ctx = app.bulk_.front();
+					app.bulk_.pop_front();
+				}
+				run(ctx);
+			}
+
+			// low like the first arm, a default priority timeout would run ahead of layout and redraw
+			gtk::lib().g_timeout_add_full(gtk::PRIORITY_LOW, Animator::FrameInterval - BulkBudget, onBulk, nullptr, nullptr);
+			return gtk::SOURCE_REMOVE;
+		}
+
+		static utils::TaskPool& pool()
+		{
+			static utils::TaskPool tasks([]()
+			{
+				gtk::lib().g_idle_add((gtk::SourceFunc)([](void*) -> bool
+				{
+					pool().drainUI();
+					return gtk::SOURCE_REMOVE;
+				}), nullptr);
+			});
+			return tasks;
+		}
+
+		// gtk3 notifies the theme name and the preference separately, report real changes only
+		static void onThemeNotify(void* obj, void* pspec, void* data)
+		{
+			Application& app = instance();
+			bool dark = gtk::lib().is_dark_mode();
+			if (app.dark_.exchange(dark) != dark && app.onThemeChanged_)
+				app.onThemeChanged_(dark);
+		}
+
 	private:
 		gtk::Application* app_;
 		std::thread ui_;
+		std::thread::id uiId_;
+		Loop loop_ = OwnThread;
+		std::mutex bulkMtx_;
+		std::deque<RunContext*> bulk_;
+		bool bulkScheduled_ = false; // an idle or timeout source will drain bulk_
+		std::atomic<bool> quit_{ false }; // HostThread
+		std::atomic<bool> dark_{ false };
+		OnThemeChangedFunc onThemeChanged_;
 	};
 
 	class Window : public Handle
 	{
 	public:
 		using TimerFunc = std::function<bool()>;
+		using WatchFunc = std::function<bool(int fd)>;
 		using OnCloseFunc = std::function<void()>;
 
 		enum
 		{
 			TimerCount = 32,
+			WatchCount = 32,
 			WidgetCount = 64
 		};
 
 		Window() = default;
-		~Window() = default;
+
+		~Window()
+		{
+			Application::runOnUI([=]()
+			{
+				if (tick_)
+					gtk::lib().gtk_widget_remove_tick_callback(handle_, tick_);
+				for (auto& watch : watches_)
+				{
+					if (watch.id_)
+						gtk::lib().g_source_remove(watch.id_);
+				}
+				for (int i = 0; i < widgetIndex_; ++i)
+					widgets_[i]->setWindow(nullptr);
+			});
+		}
 
 		bool create()
 		{
@@ -1930,15 +7830,16 @@ namespace minui
 
 		const char* title() const
 		{
-			return title_;
+			return title_.c_str();
 		}
 
 		void setTitle(const char* text)
 		{
-			title_ = text;
+			utils::String title = text;
+			title_ = title;
 			Application::runOnUI([=]()
 			{
-				gtk::lib().gtk_window_set_title(handle_, title_);
+				gtk::lib().gtk_window_set_title(handle_, title.c_str());
 			});
 		}
 
@@ -1970,16 +7871,39 @@ namespace minui
 
 		bool addTimer(int msec, const TimerFunc& fn)
 		{
-			Application::runOnUI([=]()
+			Application::runOnUI([=]()
+			{
+				if (timerIndex_ < TimerCount)
+				{
+					timers_[timerIndex_] = fn;
+					gtk::lib().g_timeout_add(msec, gtk::SourceFunc(onTimeout), &timers_[timerIndex_]);
+					timerIndex_++;
+				}
+			});
+			return timerIndex_ >= TimerCount;
+		}
+
+		// fn runs on the ui thread when fd is readable or hung up, return true to remove the watch.
+		// True when all WatchCount slots are taken, like addTimer. Only this backend has watches,
+		// the software loop (MINUI_HEADLESS, MINUI_GTK_DIRECT) does not poll fds.
+		bool addWatch(int fd, const WatchFunc& fn)
+		{
+			bool full = true;
+			Application::runOnUI([&]()
 			{
-				if (timerIndex_ < TimerCount)
+				for (auto& watch : watches_)
 				{
-					timers_[timerIndex_] = fn;
-					gtk::lib().g_timeout_add(msec, gtk::SourceFunc(onTimeout), &timers_[timerIndex_]);
-					timerIndex_++;
+					if (!watch.id_)
+					{
+						watch.fd_ = fd;
+						watch.fn_ = fn;
+						watch.id_ = gtk::lib().g_unix_fd_add(fd, gtk::IO_IN | gtk::IO_ERR | gtk::IO_HUP, gtk::FdFunc(onWatch), &watch);
+						full = false;
+						break;
+					}
 				}
 			});
-			return timerIndex_ >= TimerCount;
+			return full;
 		}
 
 		void show()
@@ -2039,6 +7963,42 @@ namespace minui
 		}
 
 	private:
+		friend class Widget;
+
+		// the widget is going away, drop it with its tweens
+		void detach(Widget* w)
+		{
+			animator_.stop(w);
+			for (int i = 0; i < widgetIndex_; ++i)
+			{
+				if (widgets_[i] == w)
+				{
+					memmove(&widgets_[i], &widgets_[i + 1], (widgetIndex_ - i - 1) * sizeof(Widget*));
+					widgetIndex_--;
+					break;
+				}
+			}
+		}
+
+		// ui thread, the tick callback runs only while something is animating
+		void animate(const Widget* owner, const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat)
+		{
+			animator_.start(owner, key, msec, easing, fn, gtk::lib().g_get_monotonic_time() / 1000, repeat);
+			if (animator_.active() && !tick_)
+				tick_ = gtk::lib().gtk_widget_add_tick_callback(handle_, gtk::TickFunc(onTick), this, nullptr);
+		}
+
+		// frame clock of the window, paused while it is not mapped
+		static bool onTick(void* w, void* clock, void* data)
+		{
+			auto self = (Window*)data;
+			if (self->animator_.tick(gtk::lib().gdk_frame_clock_get_frame_time(clock) / 1000))
+				return gtk::SOURCE_CONTINUE;
+
+			self->tick_ = 0;
+			return gtk::SOURCE_REMOVE;
+		}
+
 		static bool onClose(void* obj, void* data)
 		{
 			auto self = (Window*)data;
@@ -2050,21 +8010,45 @@ namespace minui
 		static bool onTimeout(void* data)
 		{
 			auto pf = (TimerFunc*)data;
+			Metrics::Scope scope(Metrics::Timer);
+			Trace::Scope trace("timer");
 			bool stop = (*pf)();
 			return stop ? gtk::SOURCE_REMOVE : gtk::SOURCE_CONTINUE;
 		}
 
+		static bool onWatch(int fd, int cond, void* data)
+		{
+			auto watch = (Watch*)data;
+			if (!watch->fn_(fd))
+				return gtk::SOURCE_CONTINUE;
+
+			// free the slot for the next addWatch
+			watch->id_ = 0;
+			watch->fn_ = nullptr;
+			return gtk::SOURCE_REMOVE;
+		}
+
+		struct Watch
+		{
+			int id_ = 0; // main loop source, 0 while the slot is free
+			int fd_ = -1;
+			WatchFunc fn_;
+		};
+
 	private:
 		gtk::Window* handle_ = nullptr;
 		gtk::Fixed* fixed_ = nullptr;
 		gtk::Widget* titleBar_ = nullptr;
-		const char* title_ = nullptr;
+		utils::String title_;
 		Rect rect_ = {0, 0, 0, 0};
 		int timerIndex_ = 0;
 		int widgetIndex_ = 0;
 		TimerFunc timers_[TimerCount];
+		Watch watches_[WatchCount];
 		Widget* widgets_[WidgetCount];
 		OnCloseFunc onClose_;
+		Animator animator_;
+		unsigned tick_ = 0; // frame clock callback, only while something is animating
 		bool closeable_ = true;
 	};
 	
@@ -2075,165 +8059,906 @@ namespace minui
 		{
 			Application::runOnUI([=]()
 			{
-				handle_ = gtk::lib().gtk_label_new("");
+				Trace::Scope trace("widget_create");
+				handle_ = gtk::lib().gtk_label_new("");
+				setHandle(handle_);
+				setStyleName("Label");
+			});
+		}
+
+		const char* text() const
+		{
+			return text_.c_str();
+		}
+
+		void setText(const char* text)
+		{
+			utils::String str = text;
+			text_ = str;
+			Application::runOnUI([=]()
+			{
+				gtk::lib().gtk_label_set_text(handle_, str.c_str());
+			});
+		}
+
+	private:
+		gtk::Label* handle_ = nullptr;
+		utils::String text_;
+	};
+	
+	class Button : public Widget
+	{
+	public:
+		enum State
+		{
+			Normal,
+			Hover,
+			Press
+		};
+
+		using OnClickFunc = std::function<void()>;
+
+		Button()
+		{
+			Application::runOnUI([=]()
+			{
+				Trace::Scope trace("widget_create");
+				handle_ = gtk::lib().gtk_button_new();
+				setHandle(handle_);
+				setStyleName("Button");
+			});
+		}
+
+		const char* text() const
+		{
+			return text_.c_str();
+		}
+
+		void setText(const char* text)
+		{
+			utils::String str = text;
+			text_ = str;
+			Application::runOnUI([=]()
+			{
+				gtk::lib().gtk_button_set_label(handle_, str.c_str());
+			});
+		}
+
+		void setOnClick(const OnClickFunc& fn)
+		{
+			onClick_ = fn;
+			Application::runOnUI([=]()
+			{
+				gtk::lib().g_signal_connect_data(handle_, "clicked", gtk::Callback(onClick), this, nullptr, gtk::CONNECT_DEFAULT);
+			});
+		}
+
+	private:
+		static void onClick(void* obj, void* data)
+		{
+			auto self = (Button*)data;
+			self->onClick_();
+		}
+
+	private:
+		gtk::Button* handle_ = nullptr;
+		utils::String text_;
+		OnClickFunc onClick_;
+	};
+
+	class Progress : public Widget
+	{
+	public:
+		Progress()
+		{
+			Application::runOnUI([=]()
+			{
+				Trace::Scope trace("widget_create");
+				handle_ = gtk::lib().gtk_progress_bar_new();
+				setHandle(handle_);
+				setStyleName("Progress");
+			});
+		}
+
+		~Progress()
+		{
+			Application::runOnUI([=]()
+			{
+				if (tick_)
+					gtk::lib().gtk_widget_remove_tick_callback(handle_, tick_);
+			});
+		}
+
+		// msec > 0 slides from the fraction shown now, leaves indeterminate mode
+		void setStep(float step, int msec = 0)
+		{
+			if (0 <= step && step <= 1.0)
+			{
+				Application::runOnUI([=]()
+				{
+					setPulsing(false);
+					float from = step_;
+					animate(&step_, msec, Animator::EaseOut, [=](float t)
+					{
+						step_ = Animator::lerp(from, step, t);
+						gtk::lib().gtk_progress_bar_set_fraction(handle_, step_);
+					});
+				});
+			}
+		}
+
+		bool indeterminate() const
+		{
+			return tick_ != 0;
+		}
+
+		// unknown amount of work: gtk_progress_bar_pulse from the bar's frame clock, no calls needed
+		void setIndeterminate(bool v)
+		{
+			Application::runOnUI([=]()
+			{
+				setPulsing(v);
+				if (!v)
+					gtk::lib().gtk_progress_bar_set_fraction(handle_, step_);
+			});
+		}
+
+	private:
+		enum { PulseInterval = 100 }; // ms, gtk smooths the block between pulses
+
+		void setPulsing(bool v)
+		{
+			if (v && !tick_)
+			{
+				nextPulse_ = 0;
+				tick_ = gtk::lib().gtk_widget_add_tick_callback(handle_, gtk::TickFunc(onTick), this, nullptr);
+			}
+			else if (!v && tick_)
+			{
+				gtk::lib().gtk_widget_remove_tick_callback(handle_, tick_);
+				tick_ = 0;
+			}
+		}
+
+		static bool onTick(void* w, void* clock, void* data)
+		{
+			auto self = (Progress*)data;
+			int64_t now = gtk::lib().gdk_frame_clock_get_frame_time(clock) / 1000;
+			if (now >= self->nextPulse_)
+			{
+				self->nextPulse_ = now + PulseInterval;
+				gtk::lib().gtk_progress_bar_pulse(self->handle_);
+			}
+			return gtk::SOURCE_CONTINUE;
+		}
+
+		gtk::ProgressBar* handle_ = nullptr;
+		float step_ = 0; // ui thread
+		unsigned tick_ = 0;
+		int64_t nextPulse_ = 0;
+	};
+
+	class Image : public Widget
+	{
+	public:
+		Image()
+		{
+			Application::runOnUI([=]()
+			{
+				Trace::Scope trace("widget_create");
+				handle_ = gtk::lib().gtk_image_new();
+				gtk::lib().g_signal_connect_data(handle_, "notify::scale-factor", gtk::Callback(onScaleChanged), this, nullptr, gtk::CONNECT_DEFAULT);
+				setHandle(handle_);
+				setStyleName("Image");
+			});
+		}
+
+		~Image()
+		{
+			if (!themeImage_)
+				return;
+
+			Application::runOnUI([=]()
+			{
+				Styles::instance().removeImage(this);
+				clearCache();
+			});
+		}
+
+		void setBmpData(const void* data, int size)
+		{
+			bmp_ = data;
+			bmpSize_ = size;
+			Application::runOnUI([=]()
+			{
+				showBmp();
+			});
+		}
+
+		// follows Styles::setTheme(), each theme's image is decoded once.
+		// True when Styles::ImageCount themed images exist already, the image is left as it is.
+		bool setThemeImage(const char* name)
+		{
+			bool full = false;
+			Application::runOnUI([&]()
+			{
+				if (!themeImage_ && Styles::instance().addImage(this))
+				{
+					full = true;
+					return;
+				}
+				themeImage_ = name;
+				applyTheme(Styles::instance().theme());
+			});
+			return full;
+		}
+
+	private:
+		friend class Styles;
+
+		enum { CacheCount = 2 }; // light and dark
+
+		struct Cached
+		{
+			const Theme* theme_;
+			void* upload_; // gtk4 texture, gtk3 pixbuf
+		};
+
+		// at device pixels, the upload is kept until the scale factor changes
+		void* decode(const void* data, int size)
+		{
+			Metrics::Scope scope(Metrics::ImageDecode);
+			Trace::Scope trace("image_decode");
+			auto stream = gtk::lib().g_memory_input_stream_new_from_data(data, size, NULL);
+
+			scale_ = gtk::lib().image_scale(handle_);
+			gtk::Error* error = nullptr;
+			auto pixbuf = gtk::lib().gdk_pixbuf_new_from_stream_at_scale(stream, rect().width * scale_, rect().height * scale_, false, nullptr, &error);
+			gtk::lib().g_input_stream_close(stream, nullptr, nullptr);
+			gtk::lib().g_object_unref(stream);
+
+			if (error)
+			{
+				gtk::lib().g_error_free(error);
+				if (pixbuf)
+					gtk::lib().g_object_unref(pixbuf);
+				return nullptr;
+			}
+			return pixbuf ? gtk::lib().image_upload(pixbuf) : nullptr;
+		}
+
+		// ui thread
+		void showBmp()
+		{
+			auto upload = decode(bmp_, bmpSize_);
+			if (!upload)
+				return;
+
+			gtk::lib().gtk_image_set_from_upload(handle_, upload);
+			gtk::lib().g_object_unref(upload);
+		}
+
+		void clearCache()
+		{
+			for (auto& cached : cache_)
+			{
+				if (cached.upload_)
+					gtk::lib().g_object_unref(cached.upload_);
+				cached = Cached{};
+			}
+		}
+
+		// moved to a monitor with another scale factor, decode again at the new size
+		static void onScaleChanged(void* obj, void* pspec, void* data)
+		{
+			auto self = (Image*)data;
+			if (gtk::lib().image_scale(self->handle_) == self->scale_)
+				return;
+
+			if (self->themeImage_)
+			{
+				self->clearCache();
+				self->applyTheme(Styles::instance().theme());
+			}
+			else if (self->bmp_)
+			{
+				self->showBmp();
+			}
+		}
+
+		// ui thread
+		void applyTheme(const Theme& theme)
+		{
+			auto image = theme.findImage(themeImage_);
+			if (!image)
+				return;
+
+			void* upload = nullptr;
+			for (auto& cached : cache_)
+			{
+				if (cached.theme_ == &theme)
+					upload = cached.upload_;
+			}
+
+			if (!upload)
+			{
+				upload = decode(image->data, image->size);
+				if (!upload)
+					return;
+
+				Cached& slot = cache_[next_++ % CacheCount];
+				if (slot.upload_)
+					gtk::lib().g_object_unref(slot.upload_);
+				slot = Cached{ &theme, upload };
+			}
+
+			gtk::lib().gtk_image_set_from_upload(handle_, upload);
+		}
+
+		gtk::Image* handle_ = nullptr;
+		const void* bmp_ = nullptr;
+		int bmpSize_ = 0;
+		const char* themeImage_ = nullptr;
+		Cached cache_[CacheCount] = {};
+		int next_ = 0;
+		int scale_ = 0; // of the uploads
+	};
+
+	class ListView : public Widget
+	{
+	public:
+		enum
+		{
+			ColumnCount = 4,
+			RowCount = 40, // max visible rows
+			TextLength = 128,
+			Padding = 6
+		};
+
+		using DataFunc = std::function<void(int row, int column, char* text, int length)>;
+
+		ListView()
+		{
+			for (int i = 0; i < ColumnCount; ++i)
+			{
+				widths_[i] = 0;
+				alignRight_[i] = false;
+			}
+
+			Application::runOnUI([=]()
+			{
+				Trace::Scope trace("widget_create");
+				fixed_ = gtk::lib().gtk_fixed_new();
+				handle_ = gtk::lib().scroll_box_new(fixed_);
+				gtk::lib().connect_scroll(handle_, onScroll, this);
 				setHandle(handle_);
-				setStyleName("Label");
+				setStyleName("ListView");
 			});
 		}
 
-		const char* text() const
+		// columns are fixed once rows are shown
+		void setColumn(int column, int width, bool alignRight = false)
 		{
-			return text_;
+			if (0 <= column && column < ColumnCount)
+			{
+				widths_[column] = width;
+				alignRight_[column] = alignRight;
+				if (column >= columns_)
+					columns_ = column + 1;
+			}
 		}
 
-		void setText(const char* text)
+		void setRowHeight(int height)
+		{
+			if (height > 0)
+				rowHeight_ = height;
+		}
+
+		void setDataSource(int count, const DataFunc& fn)
 		{
-			text_ = text;
 			Application::runOnUI([=]()
 			{
-				gtk::lib().gtk_label_set_text(handle_, text_);
+				data_ = fn;
+				count_ = count;
+				first_ = 0;
+				reloadRows();
 			});
 		}
 
-	private:
-		gtk::Label* handle_ = nullptr;
-		const char* text_ = nullptr;
-	};
-	
-	class Button : public Widget
-	{
-	public:
-		enum State
+		int count() const
 		{
-			Normal,
-			Hover,
-			Press
-		};
-
-		using OnClickFunc = std::function<void()>;
+			return count_;
+		}
 
-		Button()
+		void setCount(int count)
 		{
 			Application::runOnUI([=]()
 			{
-				handle_ = gtk::lib().gtk_button_new();
-				setHandle(handle_);
-				setStyleName("Button");
+				count_ = count;
+				scrollRows(first_);
 			});
 		}
 
-		const char* text() const
+		int scrollRow() const
 		{
-			return text_;
+			return first_;
 		}
 
-		void setText(const char* text)
+		void scrollTo(int row)
 		{
-			text_ = text;
 			Application::runOnUI([=]()
 			{
-				gtk::lib().gtk_button_set_label(handle_, text_);
+				scrollRows(row);
 			});
 		}
 
-		void setOnClick(const OnClickFunc& fn)
+		// drop all bound rows and fetch visible rows again
+		void reload()
 		{
-			onClick_ = fn;
 			Application::runOnUI([=]()
 			{
-				gtk::lib().g_signal_connect_data(handle_, "clicked", gtk::Callback(onClick), this, nullptr, gtk::CONNECT_DEFAULT);
+				reloadRows();
 			});
 		}
 
 	private:
-		static void onClick(void* obj, void* data)
+		struct Row
 		{
-			auto self = (Button*)data;
-			self->onClick_();
+			int index;
+			int y;
+			bool visible;
+			gtk::Label* labels[ColumnCount];
+		};
+
+		static void onScroll(double dy, void* data)
+		{
+			auto self = (ListView*)data;
+			self->scrollDelta_ += dy * 3;
+			int rows = int(self->scrollDelta_);
+			self->scrollDelta_ -= rows;
+			if (rows)
+				self->scrollRows(self->first_ + rows);
 		}
 
-	private:
-		gtk::Button* handle_ = nullptr;
-		const char* text_ = nullptr;
-		OnClickFunc onClick_;
-	};
+		int columnWidth(int column) const
+		{
+			if (widths_[column] > 0)
+				return widths_[column];
 
-	class Progress : public Widget
-	{
-	public:
-		Progress()
+			// unsized column takes the rest
+			int width = rect().width;
+			for (int i = 0; i < columns_; ++i)
+				width -= widths_[i];
+			return width > 0 ? width : 0;
+		}
+
+		void createRows()
 		{
-			Application::runOnUI([=]()
+			if (poolRows_)
+				return;
+
+			poolRows_ = rect().height / rowHeight_;
+			if (poolRows_ > RowCount)
+				poolRows_ = RowCount;
+
+			for (int i = 0; i < poolRows_; ++i)
 			{
-				handle_ = gtk::lib().gtk_progress_bar_new();
-				setHandle(handle_);
-				setStyleName("Progress");
-			});
+				Row& row = rows_[i];
+				row.index = -1;
+				row.y = 0;
+				row.visible = true;
+
+				int x = 0;
+				for (int c = 0; c < columns_; ++c)
+				{
+					int width = columnWidth(c);
+					auto label = gtk::lib().gtk_label_new("");
+					gtk::lib().gtk_label_set_xalign(label, alignRight_[c] ? 1.0 : 0.0);
+					gtk::lib().gtk_label_set_ellipsize(label, gtk::ELLIPSIZE_END);
+					gtk::lib().gtk_widget_set_size_request(label, width - Padding * 2, rowHeight_);
+					gtk::lib().gtk_fixed_put(fixed_, label, x + Padding, 0);
+					gtk::lib().gtk_widget_set_visible(label, true);
+					row.labels[c] = label;
+					x += width;
+				}
+			}
 		}
 
-		void setStep(float step)
+		void scrollRows(int row)
 		{
-			if (0 <= step && step <= 1.0)
+			int last = count_ - (rect().height / rowHeight_);
+			if (row > last)
+				row = last;
+			if (row < 0)
+				row = 0;
+
+			first_ = row;
+			bindRows();
+		}
+
+		void reloadRows()
+		{
+			for (int i = 0; i < poolRows_; ++i)
+				rows_[i].index = -1;
+			bindRows();
+		}
+
+		// rows recycle by slot, scrolling moves labels and only fetches rows which are new in view
+		void bindRows()
+		{
+			createRows();
+
+			for (int i = 0; i < poolRows_; ++i)
 			{
-				Application::runOnUI([=]()
+				int index = first_ + i;
+				Row& row = rows_[index % poolRows_];
+				bool visible = index < count_;
+
+				if (visible && row.index != index)
 				{
-					gtk::lib().gtk_progress_bar_set_fraction(handle_, step);
-				});
+					row.index = index;
+					for (int c = 0; c < columns_; ++c)
+					{
+						text_[0] = 0;
+						if (data_)
+							data_(index, c, text_, TextLength);
+						text_[TextLength - 1] = 0;
+						gtk::lib().gtk_label_set_text(row.labels[c], text_);
+					}
+				}
+
+				int y = i * rowHeight_;
+				if (row.y != y)
+				{
+					row.y = y;
+					int x = 0;
+					for (int c = 0; c < columns_; ++c)
+					{
+						gtk::lib().gtk_fixed_move(fixed_, row.labels[c], x + Padding, y);
+						x += columnWidth(c);
+					}
+				}
+
+				if (row.visible != visible)
+				{
+					row.visible = visible;
+					for (int c = 0; c < columns_; ++c)
+						gtk::lib().gtk_widget_set_visible(row.labels[c], visible);
+				}
 			}
 		}
 
 	private:
-		gtk::ProgressBar* handle_ = nullptr;
+		gtk::Widget* handle_ = nullptr;
+		gtk::Fixed* fixed_ = nullptr;
+		DataFunc data_;
+		int count_ = 0;
+		int first_ = 0;
+		int rowHeight_ = 24;
+		int columns_ = 1;
+		int poolRows_ = 0;
+		double scrollDelta_ = 0;
+		int widths_[ColumnCount];
+		bool alignRight_[ColumnCount];
+		Row rows_[RowCount];
+		char text_[TextLength];
 	};
 
-	class Image : public Widget
+	namespace ipc
 	{
-	public:
-		Image()
+		// Progress and status written by a headless producer process into shared memory.
+		// Writes are a seqlock update on the mapping, the eventfd is only written when the UI side sleeps.
+		class ProgressChannel : public Handle
 		{
-			Application::runOnUI([=]()
+		public:
+			enum
 			{
-				handle_ = gtk::lib().gtk_image_new();
-				setHandle(handle_);
-				setStyleName("Image");
-			});
-		}
+				StatusLength = 256,
+				FrameInterval = 16, // ms
+				ReadRetries = 1000 // a producer that died mid-write leaves the seq odd
+			};
 
-		void setBmpData(const void* data, int size)
-		{
-			bmp_ = data;
-			Application::runOnUI([=]()
+			ProgressChannel() = default;
+
+			~ProgressChannel()
+			{
+				// the sources hold this
+				if (watchId_ || frameId_)
+				{
+					Application::runOnUI([=]()
+					{
+						if (watchId_)
+							gtk::lib().g_source_remove(watchId_);
+						if (frameId_)
+							gtk::lib().g_source_remove(frameId_);
+					});
+				}
+
+				if (state_)
+					munmap(state_, sizeof(State));
+				if (memFd_ != -1)
+					close(memFd_);
+				if (eventFd_ != -1)
+					close(eventFd_);
+			}
+
+			// ui side, the fds are inheritable and passed to the producer process
+			bool create()
+			{
+				memFd_ = createMemFd();
+				if (memFd_ == -1 || ftruncate(memFd_, sizeof(State)) != 0)
+					return false;
+
+				eventFd_ = eventfd(0, EFD_NONBLOCK);
+				if (eventFd_ == -1)
+					return false;
+
+				if (!map())
+					return false;
+
+				state_->armed.store(1, std::memory_order_release);
+				return true;
+			}
+
+			// producer side
+			bool attach(int memFd, int eventFd)
+			{
+				memFd_ = memFd;
+				eventFd_ = eventFd;
+				return map();
+			}
+
+			int memFd() const
+			{
+				return memFd_;
+			}
+
+			int eventFd() const
+			{
+				return eventFd_;
+			}
+
+			void setStep(float step)
+			{
+				write([=]()
+				{
+					state_->step = step;
+				});
+			}
+
+			void setStatus(const char* text)
+			{
+				write([=]()
+				{
+					strncpy(state_->status, text, StatusLength - 1);
+					state_->status[StatusLength - 1] = 0;
+				});
+			}
+
+			void update(float step, const char* text)
+			{
+				write([=]()
+				{
+					state_->step = step;
+					strncpy(state_->status, text, StatusLength - 1);
+					state_->status[StatusLength - 1] = 0;
+				});
+			}
+
+			// ui side, apply updates to widgets at most once per frame
+			void bind(Progress* progress, Label* label)
+			{
+				progress_ = progress;
+				label_ = label;
+				Application::runOnUI([=]()
+				{
+					watchId_ = gtk::lib().g_unix_fd_add(eventFd_, gtk::IO_IN, gtk::FdFunc(onWake), this);
+				});
+			}
+
+		private:
+			struct State
+			{
+				std::atomic<uint32_t> seq; // odd while writing
+				std::atomic<uint32_t> armed; // ui side sleeps, wake it up on next write
+				float step;
+				char status[StatusLength];
+			};
+
+			static int createMemFd()
 			{
-    			auto stream = gtk::lib().g_memory_input_stream_new_from_data(bmp_, size, NULL);
-    
-				gtk::Error* error = nullptr;
-				auto pixbuf = gtk::lib().gdk_pixbuf_new_from_stream_at_scale(stream, rect().width, rect().height, false, nullptr, &error);
-				gtk::lib().g_input_stream_close(stream, nullptr, nullptr);
-				if (error)
+				int fd = -1;
+			#ifdef SYS_memfd_create
+				fd = syscall(SYS_memfd_create, "minui-progress", 0);
+				if (fd != -1)
+					return fd;
+			#endif
+				// no memfd before linux 3.17, use an unlinked file in tmpfs
+				char path[64];
+				snprintf(path, sizeof(path), "/dev/shm/minui-progress-%d-%p", int(getpid()), (void*)&path);
+				fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+				if (fd != -1)
+					unlink(path);
+				return fd;
+			}
+
+			bool map()
+			{
+				void* addr = mmap(nullptr, sizeof(State), PROT_READ | PROT_WRITE, MAP_SHARED, memFd_, 0);
+				if (addr == MAP_FAILED)
+					return false;
+
+				state_ = (State*)addr;
+				return true;
+			}
+
+			template <typename F>
+			void write(const F& fn)
+			{
+				if (!state_)
 					return;
 
-				gtk::lib().gtk_image_set_from_pixbuf(handle_, pixbuf);
-			});
-		}
+				uint32_t seq = state_->seq.load(std::memory_order_relaxed);
+				state_->seq.store(seq + 1, std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_release);
+				fn();
+				state_->seq.store(seq + 2, std::memory_order_release);
 
-	private:
-		gtk::Image* handle_ = nullptr;
-		const void* bmp_ = nullptr;
-	};
+				// store seq then load armed, onFrame does the reverse: without a full fence both sides can miss each other
+				std::atomic_thread_fence(std::memory_order_seq_cst);
+				if (state_->armed.load(std::memory_order_relaxed) && state_->armed.exchange(0, std::memory_order_acq_rel))
+				{
+					uint64_t one = 1;
+					::write(eventFd_, &one, sizeof(one));
+				}
+			}
+
+			// false if no consistent copy was seen within ReadRetries, seq is the last one seen either way
+			bool read(float& step, char* status, uint32_t& seq) const
+			{
+				for (int i = 0; i < ReadRetries; ++i)
+				{
+					seq = state_->seq.load(std::memory_order_acquire);
+					if (seq & 1)
+						continue;
+
+					step = state_->step;
+					memcpy(status, state_->status, StatusLength);
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (state_->seq.load(std::memory_order_relaxed) == seq)
+						return true;
+				}
+				return false;
+			}
+
+			void apply()
+			{
+				float step;
+				char status[StatusLength];
+				if (!read(step, status, seq_))
+					return; // keep the last good values, the next write moves seq again
+				status[StatusLength - 1] = 0;
+
+				if (progress_ && step != step_)
+				{
+					step_ = step;
+					progress_->setStep(step);
+				}
+
+				if (label_ && strcmp(status, status_) != 0)
+				{
+					memcpy(status_, status, StatusLength);
+					label_->setText(status_);
+				}
+			}
+
+			static bool onWake(int fd, int cond, void* data)
+			{
+				auto self = (ProgressChannel*)data;
+				uint64_t count;
+				while (::read(fd, &count, sizeof(count)) > 0);
+
+				self->apply();
+				if (!self->frameId_)
+					self->frameId_ = gtk::lib().g_timeout_add(FrameInterval, gtk::SourceFunc(onFrame), self);
+				return gtk::SOURCE_CONTINUE;
+			}
+
+			// keep applying per frame while the producer writes, then sleep on the eventfd again
+			static bool onFrame(void* data)
+			{
+				auto self = (ProgressChannel*)data;
+				if (self->state_->seq.load(std::memory_order_acquire) != self->seq_)
+				{
+					self->apply();
+					return gtk::SOURCE_CONTINUE;
+				}
+
+				self->state_->armed.store(1, std::memory_order_seq_cst);
+				if (self->state_->seq.load(std::memory_order_seq_cst) != self->seq_ && self->state_->armed.exchange(0))
+				{
+					self->apply(); // written while arming
+					return gtk::SOURCE_CONTINUE;
+				}
+				self->frameId_ = 0;
+				return gtk::SOURCE_REMOVE;
+			}
+
+		private:
+			State* state_ = nullptr;
+			int memFd_ = -1;
+			int eventFd_ = -1;
+			uint32_t seq_ = 0;
+			int watchId_ = 0; // eventfd source
+			int frameId_ = 0; // per-frame apply while the producer writes
+			float step_ = -1;
+			char status_[StatusLength] = { 0 };
+			Progress* progress_ = nullptr;
+			Label* label_ = nullptr;
+		};
+	}
 
 	inline void Styles::initCss()
 	{
 		Application::runOnUI([=]()
 		{
-			css_ = gtk::lib().gtk_css_provider_new();
-			gtk::lib().g_signal_connect_data(css_, "parsing-error", gtk::Callback([](){}), nullptr, nullptr, gtk::CONNECT_DEFAULT);
-			gtk::lib().gtk_css_provider_load_from_data(css_, "window {}", -1);
-    		gtk::lib().gtk_style_context_add_provider_for_display(gtk::lib().gdk_display_get_default(), css_, gtk::STYLE_PROVIDER_PRIORITY_APPLICATION);
+			Theme& active = theme();
+			if (!active.css_)
+				active.updateCss();
+    		gtk::lib().gtk_style_context_add_provider_for_display(gtk::lib().gdk_display_get_default(), active.css_, gtk::STYLE_PROVIDER_PRIORITY_APPLICATION);
+		});
+	}
+
+	inline void Styles::setTheme(Theme* theme)
+	{
+		if (!theme)
+			theme = &Theme::builtin(Application::isDarkMode());
+
+		Application::runOnUI([=]()
+		{
+			if (!theme->css_)
+				theme->updateCss();
+
+			Theme* old = theme_.exchange(theme, std::memory_order_acq_rel);
+			if (old == theme)
+				return;
+
+			auto display = gtk::lib().gdk_display_get_default();
+			if (old->css_)
+				gtk::lib().gtk_style_context_remove_provider_for_display(display, old->css_);
+			gtk::lib().gtk_style_context_add_provider_for_display(display, theme->css_, gtk::STYLE_PROVIDER_PRIORITY_APPLICATION);
+
+			for (int i = 0; i < imageIndex_; ++i)
+				images_[i]->applyTheme(*theme);
 		});
 	}
 
-	inline void Styles::updateCss()
+	inline gtk::CssProvider* Theme::newCss()
 	{
+		auto css = gtk::lib().gtk_css_provider_new();
+		gtk::lib().g_signal_connect_data(css, "parsing-error", gtk::Callback([](){}), nullptr, nullptr, gtk::CONNECT_DEFAULT);
+		gtk::lib().gtk_css_provider_load_from_data(css, "window {}", -1);
+		return css;
+	}
+
+	inline void Theme::updateCss()
+	{
+		Metrics::Scope scope(Metrics::CssReload);
+		Trace::Scope trace("css_reload");
+
+		// pre-rendered table without overrides, nothing to format
+		if (tableCss_ && styles_.count() == 0)
+		{
+			const char* css = tableCss_;
+			Application::runOnUI([=]()
+			{
+				if (!css_)
+					css_ = newCss();
+				gtk::lib().gtk_css_provider_load_from_data(css_, css, -1);
+			});
+			return;
+		}
+
 		auto nameToSel = [](const char* name) -> std::string
 		{
 			std::string str;
@@ -2244,6 +8969,7 @@ namespace minui
 			else if (strcmp(name, "button") == 0) str = ".Button";
 			else if (strcmp(name, "button:hover") == 0) str = ".Button:hover";
 			else if (strcmp(name, "button:press") == 0) str = ".Button:press";
+			else if (strcmp(name, "listview") == 0) str = ".ListView";
 			else str = "." + std::string(name);
 
 			// prefix
@@ -2257,14 +8983,8 @@ namespace minui
 		};
 
 		std::ostringstream buf;
-		buf << "headerbar { border: 0px; outline: none; background-image: none; box-shadow: none; text-shadow: none; }\n";
-		buf << "headerbar button { color: rgb(110, 110, 110); outline: none; box-shadow: none; -gtk-icon-shadow: none; }\n";
-		for (int i = 0; i < MaxCount; ++i)
+		auto format = [&](const Style& style)
 		{
-			const Style& style = styles_[i];
-			if (!style.name)
-				break;
-
 			buf << nameToSel(style.name) << "{\n"
 			<< "\t" << "border: 0px; outline: none; background-image: none; box-shadow: none; text-shadow: none; \n"
 			<< "\t" << "color: rgb(" <<  (int)style.color.r << "," << (int)style.color.g << "," << (int)style.color.b << ");\n"
@@ -2280,13 +9000,31 @@ namespace minui
 				buf << fontName << ",";
 			}
 			buf << "\";\n"
+			<< "\t" << "transition: " << MINUI_CSS_TRANSITION << ";\n"
 			<< "}\n";
+		};
+
+		if (tableCss_)
+		{
+			buf << tableCss_;
+		}
+		else
+		{
+			buf << MINUI_CSS_HEADERBAR;
+			for (int i = 0; i < tableCount_; ++i)
+				format(table_[i]);
 		}
 
+		// overrides come last so they win over the table
+		for (int i = 0; i < styles_.count(); ++i)
+			format(styles_.style(i));
+
 		std::string str = buf.str();
 
 		Application::runOnUI([=]()
 		{
+			if (!css_)
+				css_ = newCss();
 			gtk::lib().gtk_css_provider_load_from_data(css_, str.c_str(), str.length());
 		});
 	}
@@ -2308,6 +9046,37 @@ namespace minui
 			gtk::lib().gtk_widget_set_visible(handle_, v);
 		});
 	}
+
+	inline Widget::~Widget()
+	{
+		// widgets_ and the tweens belong to the ui thread
+		Application::runOnUI([=]()
+		{
+			if (window_)
+				window_->detach(this);
+		});
+	}
+
+	inline void Widget::animate(const void* key, int msec, Animator::Easing easing, const Animator::ApplyFunc& fn, bool repeat)
+	{
+		if (window_)
+			window_->animate(this, key, msec, easing, fn, repeat);
+		else
+			fn(1);
+	}
+
+	inline void Widget::setOpacity(float opacity, int msec)
+	{
+		Application::runOnUI([=]()
+		{
+			float from = opacity_;
+			animate(&opacity_, msec, Animator::EaseOut, [=](float t)
+			{
+				opacity_ = Animator::lerp(from, opacity, t);
+				gtk::lib().gtk_widget_set_opacity(handle_, opacity_);
+			});
+		});
+	}
 }
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file